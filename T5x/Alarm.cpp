@@ -0,0 +1,52 @@
+#include "Alarm.h"
+#include "config.h"
+
+
+namespace t5x
+{
+
+Alarm::Alarm()
+:m_Orange(0), m_Red(0), m_Hysteresis(0), m_Level(Level_None), m_Pending(Level_None), m_Count(0)
+{
+}
+
+
+void Alarm::setThresholds(uint16_t aOrange, uint16_t aRed, uint8_t aHysteresis)
+{
+  m_Orange     = aOrange;
+  m_Red        = aRed;
+  m_Hysteresis = aHysteresis;
+  m_Level      = Level_None;
+  m_Pending    = Level_None;
+  m_Count      = 0;
+}
+
+
+boolean Alarm::update(uint16_t aValue)
+{
+  // a level that is already active holds until the value clears its threshold plus the hysteresis
+  Level target;
+  if      (aValue < m_Red    || (m_Level == Level_Red  && aValue - m_Red    < m_Hysteresis)) target = Level_Red;
+  else if (aValue < m_Orange || (m_Level != Level_None && aValue - m_Orange < m_Hysteresis)) target = Level_Orange;
+  else target = Level_None;
+
+  if (target == m_Level)
+  {
+    m_Count = 0;
+    return false;
+  }
+
+  if (target != m_Pending)
+  {
+    m_Pending = target;
+    m_Count   = 0;
+  }
+  if (++m_Count < T5X_ALARM_DEBOUNCE) return false;
+
+  boolean worse = target > m_Level;
+  m_Level = target;
+  m_Count = 0;
+  return worse;
+}
+
+} // namespace end
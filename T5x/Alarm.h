@@ -0,0 +1,44 @@
+#ifndef ALARM_H
+#define ALARM_H
+
+#include <Arduino.h>
+
+namespace t5x
+{
+
+// Two level low value alarm working on raw ADC/telemetry values.
+// Thresholds are computed once when settings are applied, so update() is just integer compares.
+class Alarm
+{
+  public:
+    enum Level
+    {
+      Level_None,
+      Level_Orange,
+      Level_Red
+    };
+
+    Alarm();
+
+    // aOrange, aRed: the alarm is raised while the value is below the threshold
+    // aHysteresis:   the value has to rise this much above a threshold to clear it again
+    void          setThresholds(uint16_t aOrange, uint16_t aRed, uint8_t aHysteresis);
+
+    // feeds a new value, a level change only takes effect after T5X_ALARM_DEBOUNCE equal results in a row
+    // returns true if the alarm got worse
+    boolean       update(uint16_t aValue);
+
+    Level         level() const { return m_Level; }
+
+  private:
+    uint16_t      m_Orange;
+    uint16_t      m_Red;
+    uint8_t       m_Hysteresis;
+    Level         m_Level;
+    Level         m_Pending;       // level waiting to be confirmed by the debounce counter
+    uint8_t       m_Count;
+};
+
+} // namespace end
+
+#endif
@@ -0,0 +1,125 @@
+#include "BulkTransfer.h"
+#include "Profile.h"
+#include "TxDeviceProperties.h"
+#include "EEPROMQueue.h"
+#include "Protocol.h"
+#include "util.h"
+
+
+namespace t5x
+{
+
+BulkTransfer gBulkTransfer;
+
+
+static uint16_t slotAddress(uint8_t aSlot)
+{
+  if (aSlot == T5X_BULK_SLOT_DEVICE) return T5X_DEVICE_PROPS_EEPROM_STARTADDR;
+  return T5X_PROFILE_EEPROM_STARTADDR + aSlot*T5X_PROFILE_EEPROM_RESERVED_BYTES;
+}
+
+
+// most bytes of record data the slot can hold
+static uint8_t slotLength(uint8_t aSlot)
+{
+  if (aSlot == T5X_BULK_SLOT_DEVICE) return T5X_DEVICE_PROPS_EEPROM_RESERVED_BYTES - sizeof(RecordHeader_t);
+  return T5X_PROFILE_EEPROM_RESERVED_BYTES - sizeof(RecordHeader_t);
+}
+
+
+BulkTransfer::BulkTransfer()
+:m_ExportSlot(T5X_BULK_SLOTS), m_Count(0), m_CRC(0xFFFF)
+{
+}
+
+
+void BulkTransfer::startExport()
+{
+  m_ExportSlot = 0;
+  m_Count      = 0;
+  m_CRC        = 0xFFFF;
+}
+
+
+void BulkTransfer::exportNext()
+{
+  if (!isExporting()) return;
+
+  EEPROMQueue::flush();     // a save that is still running would change the records under our feet
+
+  uint8_t  slot    = m_ExportSlot++;
+  uint16_t address = slotAddress(slot);
+  RecordHeader_t header;
+  EEPROM_readAnything(address, header);
+  if (checkRecord(address, slotLength(slot)) == 0) memset(&header, 0, sizeof(header));   // a damaged record goes out as an empty slot
+
+  gProtocol.sendBegin(T5X_MSG_BULK_RECORD_INFO_MSGID, 1 + sizeof(header) + header.Length);
+  sendPiece(&slot, 1);
+  sendPiece(&header, sizeof(header));
+  address += sizeof(header);
+  for (uint8_t done = 0; done < header.Length; )
+  {
+    uint8_t chunk[16];      // data goes straight from EEPROM to the serial port
+    uint8_t length = min(header.Length - done, (int)sizeof(chunk));
+    for (uint8_t i=0; i<length; i++) chunk[i] = EEPROM.read(address++);
+    sendPiece(chunk, length);
+    done += length;
+  }
+  gProtocol.sendEnd();
+  m_Count++;
+
+  if (!isExporting())
+  {
+    uint8_t summary[3] = {m_Count, uint8_t(m_CRC), uint8_t(m_CRC >> 8)};
+    gProtocol.send(T5X_MSG_BULK_DONE_INFO_MSGID, summary, sizeof(summary));
+  }
+}
+
+
+void BulkTransfer::sendPiece(const void* aData, uint8_t aLength)
+{
+  m_CRC = crc16(m_CRC, aData, aLength);
+  gProtocol.sendData(aData, aLength);
+}
+
+
+void BulkTransfer::startImport()
+{
+  m_ExportSlot = T5X_BULK_SLOTS;
+  m_Count      = 0;
+  m_CRC        = 0xFFFF;
+}
+
+
+uint8_t BulkTransfer::importRecord(const byte aPayload[], uint8_t aLength)
+{
+  RecordHeader_t header;
+  if (aLength < 1 + sizeof(header)) return T5X_NAK_LENGTH;
+  uint8_t slot = aPayload[0];
+  memcpy(&header, aPayload + 1, sizeof(header));
+  const byte* data = aPayload + 1 + sizeof(header);
+
+  if (slot >= T5X_BULK_SLOTS || header.Length != aLength - 1 - sizeof(header) || header.Length > slotLength(slot)) return T5X_NAK_LENGTH;
+  if (header.Version == 0 ? header.Length != 0 : crc16(crc16(0xFFFF, &header, 2), data, header.Length) != header.CRC) return T5X_NAK_CRC;
+
+  // an empty slot is written as an invalid header, so the slot falls back to the defaults like it did on the source.
+  // written right away, see BulkTransfer.h for what that means for a transfer that breaks off
+  uint16_t address = slotAddress(slot);
+  EEPROMQueue::write(address + sizeof(header), data, header.Length);
+  EEPROMQueue::write(address, aPayload + 1, sizeof(header));
+  EEPROMQueue::flush();     // the payload is overwritten by the next message
+
+  m_Count++;
+  m_CRC = crc16(m_CRC, aPayload, aLength);
+  return 0;
+}
+
+
+boolean BulkTransfer::endImport(uint8_t aCount, uint16_t aCRC)
+{
+  boolean complete = aCount == m_Count && aCRC == m_CRC;
+  startImport();            // whatever the outcome, the next import starts from scratch
+  return complete;
+}
+
+} // namespace end
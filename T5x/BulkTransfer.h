@@ -0,0 +1,50 @@
+#ifndef BULKTRANSFER_H
+#define BULKTRANSFER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+namespace t5x
+{
+
+#define T5X_BULK_SLOTS          10     // the 9 profiles, then the device properties
+#define T5X_BULK_SLOT_DEVICE     9
+
+// Copies all records between EEPROM and the configurator in one transaction.
+// Each record goes in its own message: the slot, then the record exactly as it is stored, header and data.
+// The records keep their own CRC and layout version, so an import from older firmware is migrated when it is loaded.
+// An empty slot, or one whose record fails its CRC, is sent as a header with Version 0 and Length 0;
+// importing that header empties the slot, it falls back to the defaults like it did on the source.
+// The transaction ends with the number of records and a CRC-16 over the payloads of all record messages.
+//
+// There is no room to stage a whole import, in RAM or in EEPROM, so each record is written as soon as it arrives.
+// Every record is valid on its own, but until the end message is acknowledged EEPROM may hold a mix of old and
+// new records. The TX keeps running with the configuration it has in RAM until then. If the end message is
+// rejected or the transfer breaks off, the configurator has to start over with the begin message and send all
+// records again.
+class BulkTransfer
+{
+  public:
+    BulkTransfer();
+
+    void      startExport();          // sends one record per exportNext(), then the summary
+    boolean   isExporting() { return m_ExportSlot < T5X_BULK_SLOTS; }
+    void      exportNext();
+
+    void      startImport();
+    uint8_t   importRecord(const byte aPayload[], uint8_t aLength);   // writes one record to EEPROM, 0 or the NAK reason
+    boolean   endImport(uint8_t aCount, uint16_t aCRC);               // true if every record arrived
+
+  private:
+    void      sendPiece(const void* aData, uint8_t aLength);
+
+    uint8_t   m_ExportSlot;           // next slot to export, T5X_BULK_SLOTS when done
+    uint8_t   m_Count;                // records of the current transaction
+    uint16_t  m_CRC;                  // over the record messages of the current transaction
+};
+
+extern BulkTransfer gBulkTransfer;
+
+} // namespace end
+
+#endif
@@ -0,0 +1,131 @@
+#include "EEPROMQueue.h"
+
+
+namespace t5x
+{
+
+EEPROMQueue::Request_t  EEPROMQueue::s_Queue[T5X_EEPROM_QUEUE_SIZE];
+uint8_t                 EEPROMQueue::s_Head    = 0;
+volatile uint8_t        EEPROMQueue::s_Count   = 0;
+uint8_t                 EEPROMQueue::s_Pos     = 0;
+volatile uint16_t       EEPROMQueue::s_Written = 0;
+volatile uint16_t       EEPROMQueue::s_Skipped = 0;
+#ifdef T5X_EEPROM_WEAR_COUNTERS
+volatile uint16_t       EEPROMQueue::s_Wear[E2END + 1];
+#endif
+
+
+void EEPROMQueue::write(uint16_t aAddress, const void* aData, uint8_t aLength)
+{
+  while (s_Count == T5X_EEPROM_QUEUE_SIZE)     // the interrupt makes room once the running write is done
+    loop_until_bit_is_clear(EECR, EEPE);
+
+  uint8_t oldSREG = SREG;
+  cli();
+  if (s_Count == 0)                            // new batch
+  {
+    s_Written = 0;
+    s_Skipped = 0;
+  }
+  uint8_t idx = s_Head + s_Count;
+  if (idx >= T5X_EEPROM_QUEUE_SIZE) idx -= T5X_EEPROM_QUEUE_SIZE;
+  s_Queue[idx].Address = aAddress;
+  s_Queue[idx].Data    = static_cast<const uint8_t*>(aData);
+  s_Queue[idx].Length  = aLength;
+  ++s_Count;
+  EECR |= _BV(EERIE);                          // fires right away if no write is in progress
+  SREG = oldSREG;
+}
+
+
+boolean EEPROMQueue::isBusy()
+{
+  return s_Count != 0;
+}
+
+
+void EEPROMQueue::flush()
+{
+  while (s_Count != 0)
+    loop_until_bit_is_clear(EECR, EEPE);       // polling the hardware also lets a host build's clock run
+}
+
+
+uint16_t EEPROMQueue::getWritten()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t written = s_Written;
+  SREG = oldSREG;
+  return written;
+}
+
+
+uint16_t EEPROMQueue::getSkipped()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t skipped = s_Skipped;
+  SREG = oldSREG;
+  return skipped;
+}
+
+
+#ifdef T5X_EEPROM_WEAR_COUNTERS
+uint16_t EEPROMQueue::getWrites(uint16_t aAddress)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t writes = s_Wear[aAddress];
+  SREG = oldSREG;
+  return writes;
+}
+#endif
+
+
+void EEPROMQueue::isr()
+{
+  uint8_t compared = 0;
+  while (s_Count != 0)
+  {
+    const Request_t& r = s_Queue[s_Head];
+    while (s_Pos < r.Length)
+    {
+      if (compared == T5X_EEPROM_SKIP_PER_ISR) return;   // EE_READY is still armed and fires again right away
+
+      uint8_t value = r.Data[s_Pos];
+      EEAR = r.Address + s_Pos;
+      ++s_Pos;
+      ++compared;
+
+      EECR |= _BV(EERE);                       // read takes effect immediately, no write is in progress
+      if (EEDR == value)
+      {
+        ++s_Skipped;
+        continue;
+      }
+
+      EEDR = value;
+      EECR |= _BV(EEMPE);                      // EEPE has to follow within 4 cycles, interrupts are off in here
+      EECR |= _BV(EEPE);
+      ++s_Written;
+#ifdef T5X_EEPROM_WEAR_COUNTERS
+      ++s_Wear[EEAR];
+#endif
+      return;                                  // EE_READY fires again when the write is done
+    }
+
+    s_Pos = 0;
+    if (++s_Head == T5X_EEPROM_QUEUE_SIZE) s_Head = 0;
+    --s_Count;
+  }
+  EECR &= ~_BV(EERIE);                         // all done
+}
+
+} // namespace end
+
+
+ISR(EE_READY_vect)
+{
+  t5x::EEPROMQueue::isr();
+}
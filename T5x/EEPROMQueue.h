@@ -0,0 +1,63 @@
+#ifndef EEPROMQUEUE_H
+#define EEPROMQUEUE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#if defined(T5X_EEPROM_WEAR_COUNTERS) && defined(__AVR__)
+#error "T5X_EEPROM_WEAR_COUNTERS needs 2 bytes of RAM per EEPROM cell, it is for host builds only"
+#endif
+
+namespace t5x
+{
+
+#define T5X_EEPROM_QUEUE_SIZE 12   // enough for the device properties, all 9 profiles and the version byte
+#define T5X_EEPROM_SKIP_PER_ISR 8  // cells compared per interrupt at most, so skipping a long unchanged block
+                                   // doesn't keep interrupts off for long
+
+// Writes blocks to EEPROM in the background, one byte per EE_READY interrupt.
+// Cells that already hold the right value are skipped, saving time and wear; a few of them per interrupt.
+// The source data is read when each byte is written, so it has to stay valid until the queue is idle;
+// changing it in the meantime is fine as long as it is saved again afterwards.
+// Don't use EEPROM.read/write while the queue is busy, call flush() first.
+class EEPROMQueue
+{
+  public:
+    // queues a block, only waits if the queue is full
+    static void     write(uint16_t aAddress, const void* aData, uint8_t aLength);
+
+    static boolean  isBusy();
+    static void     flush();                // waits until everything is written
+
+    static uint16_t getWritten();           // bytes written since the queue was last idle
+    static uint16_t getSkipped();           // bytes skipped since the queue was last idle, they were up to date
+#ifdef T5X_EEPROM_WEAR_COUNTERS
+    static uint16_t getWrites(uint16_t aAddress);   // bytes written to a cell since power on
+#endif
+
+    static void     isr();                  // called by the EE_READY interrupt
+
+  private:
+    EEPROMQueue();                          // not instantiable
+
+    typedef struct
+    {
+      uint16_t        Address;
+      const uint8_t*  Data;
+      uint8_t         Length;
+    } Request_t;
+
+    static Request_t          s_Queue[T5X_EEPROM_QUEUE_SIZE];
+    static uint8_t            s_Head;       // request being written
+    static volatile uint8_t   s_Count;      // queued requests
+    static uint8_t            s_Pos;        // next byte of the current request
+    static volatile uint16_t  s_Written;
+    static volatile uint16_t  s_Skipped;
+#ifdef T5X_EEPROM_WEAR_COUNTERS
+    static volatile uint16_t  s_Wear[E2END + 1];
+#endif
+};
+
+} // namespace end
+
+#endif
@@ -1,35 +1,61 @@
 #include "Frsky.h"
-#include <arduino.h>
+#include <Arduino.h>
 
 
 namespace t5x
 {
 
+// FrSky D link protocol
+#define FRSKY_START_STOP      0x7E
+#define FRSKY_BYTESTUFF       0x7D
+#define FRSKY_STUFF_MASK      0x20
+#define FRSKY_LINKPKT         0xFE
+#define FRSKY_USRPKT          0xFD
+#define FRSKY_USRPKT_MAXLEN   6
+
+// FrSky hub protocol, carried in the user data frames
+#define HUB_START_STOP        0x5E
+#define HUB_BYTESTUFF         0x5D
+#define HUB_STUFF_MASK        0x60
+
+#define HUB_GPS_ALT_BP        0x01
+#define HUB_CELL              0x06
+#define HUB_BARO_ALT_BP       0x10
+#define HUB_GPS_SPEED_BP      0x11
+#define HUB_GPS_LONG_BP       0x12
+#define HUB_GPS_LAT_BP        0x13
+#define HUB_GPS_COURSE_BP     0x14
+#define HUB_GPS_LONG_AP       0x1A
+#define HUB_GPS_LAT_AP        0x1B
+#define HUB_GPS_LONG_EW       0x22
+#define HUB_GPS_LAT_NS        0x23
+#define HUB_CURRENT           0x28
+#define HUB_VARIO             0x30
+#define HUB_VOLTS_BP          0x3A
+#define HUB_VOLTS_AP          0x3B
+
+enum
+{
+  HubState_Idle,   // waiting for 0x5E
+  HubState_Id,
+  HubState_Low,
+  HubState_High
+};
+
 Frsky::Frsky()
-:m_Counter(0), m_A1_Voltage(0), m_A2_Voltage(0), m_LastValidFrameMillis(0)
+:m_Counter(0xFF), m_Escape(false), m_LastValidFrameMillis(0),
+ m_HubState(HubState_Idle), m_HubEscape(false), m_HubId(0), m_HubLow(0), m_HubVoltageBP(0)
 {
+  memset(&m_Telemetry, 0, sizeof(m_Telemetry));
 }
 
-void Frsky::update()
+boolean Frsky::update()
 {
-    // Read RAW Data from FrSky
-    while (Serial.available()) 
-    {
-      byte b = Serial.read();  
-
-      /* 0xFD USERDATA */  /* 0xFE RSSI */
-      if (b == 0x7E && m_Counter == T5X_FRSKY_TELEMETRY_FRAMESIZE-1 && m_Data[0] == 0x7E && m_Data[1] == 0xFE )
-      {
-        m_A1_Voltage           = m_Data[2];
-        m_A2_Voltage           = m_Data[3];
-        m_RSSI                 = m_Data[4]; 
-        m_LastValidFrameMillis = millis();       
-      }
-      else if (b == 0x7D) b ^= 0x20;     // Byte stuffing!
-      else if (b == 0x7E) m_Counter = 0; // Start of Frames. 
-     
-      m_Data[m_Counter++] = b; 
-    }
+    // Read RAW Data from FrSky, the decoder keeps its state between calls
+    // so frames may be split over any number of calls.
+    boolean linkFrame = false;
+    while (Serial.available()) linkFrame |= decode(Serial.read());
+    return linkFrame;
 }
 
 
@@ -41,5 +67,125 @@ const boolean Frsky::TelemetryLinkAlive()
 }
 
 
+boolean Frsky::decode(uint8_t b)
+{
+  if (b == FRSKY_START_STOP)
+  {
+    // 0x7E ends the current frame and starts the next one, repeated 0x7E are just idle
+    boolean linkFrame = (m_Counter == T5X_FRSKY_TELEMETRY_FRAMESIZE) && decodeFrame();
+    m_Counter = 0;
+    m_Escape  = false;
+    return linkFrame;
+  }
+  if (m_Counter == 0xFF) return false;  // out of sync, wait for the next frame
+
+  if (b == FRSKY_BYTESTUFF)
+  {
+    m_Escape = true;              // unstuff the byte that follows
+    return false;
+  }
+  if (m_Escape)
+  {
+    b ^= FRSKY_STUFF_MASK;
+    m_Escape = false;
+  }
+
+  if (m_Counter >= T5X_FRSKY_TELEMETRY_FRAMESIZE)
+  {
+    m_Counter = 0xFF;             // too long, drop it
+    return false;
+  }
+  m_Data[m_Counter++] = b;
+  return false;
+}
+
+
+boolean Frsky::decodeFrame()
+{
+  switch (m_Data[0])
+  {
+    case FRSKY_LINKPKT:
+      m_Telemetry.A1_Voltage = m_Data[1];
+      m_Telemetry.A2_Voltage = m_Data[2];
+      m_Telemetry.RSSI_Rx    = m_Data[3];
+      m_Telemetry.RSSI_Tx    = m_Data[4];
+      m_LastValidFrameMillis = millis();
+      return true;
+
+    case FRSKY_USRPKT:
+    {
+      // m_Data[1] is the number of valid bytes, m_Data[2] is unused
+      uint8_t len = m_Data[1];
+      if (len > FRSKY_USRPKT_MAXLEN) break;
+      for (uint8_t i = 0; i < len; ++i) decodeHub(m_Data[3+i]);
+      break;
+    }
+  }
+  return false;
+}
+
+
+void Frsky::decodeHub(uint8_t b)
+{
+  // hub packets (0x5E id low high) may be split across user data frames
+  if (b == HUB_START_STOP)
+  {
+    m_HubState  = HubState_Id;
+    m_HubEscape = false;
+    return;
+  }
+  if (m_HubState == HubState_Idle) return;
+
+  if (b == HUB_BYTESTUFF)
+  {
+    m_HubEscape = true;
+    return;
+  }
+  if (m_HubEscape)
+  {
+    b ^= HUB_STUFF_MASK;
+    m_HubEscape = false;
+  }
+
+  switch (m_HubState)
+  {
+    case HubState_Id:   m_HubId  = b; m_HubState = HubState_Low;  break;
+    case HubState_Low:  m_HubLow = b; m_HubState = HubState_High; break;
+    case HubState_High:
+      decodeHubValue(m_HubLow | (b << 8)); // decodeHubValue reads m_HubId
+      m_HubState = HubState_Idle;
+      break;
+  }
+}
+
+
+void Frsky::decodeHubValue(uint16_t value)
+{
+  switch (m_HubId)
+  {
+    case HUB_GPS_ALT_BP:    m_Telemetry.GPSAltitude_m     = value; break;
+    case HUB_BARO_ALT_BP:   m_Telemetry.Altitude_m        = value; break;
+    case HUB_GPS_SPEED_BP:  m_Telemetry.GPSSpeed_kn       = value; break;
+    case HUB_GPS_COURSE_BP: m_Telemetry.GPSCourse_deg     = value; break;
+    case HUB_GPS_LONG_BP:   m_Telemetry.Longitude_BP      = value; break;
+    case HUB_GPS_LONG_AP:   m_Telemetry.Longitude_AP      = value; break;
+    case HUB_GPS_LONG_EW:   m_Telemetry.Longitude_EW      = value; break;
+    case HUB_GPS_LAT_BP:    m_Telemetry.Latitude_BP       = value; break;
+    case HUB_GPS_LAT_AP:    m_Telemetry.Latitude_AP       = value; break;
+    case HUB_GPS_LAT_NS:    m_Telemetry.Latitude_NS       = value; break;
+    case HUB_CURRENT:       m_Telemetry.Current_dA        = value; break;
+    case HUB_VARIO:         m_Telemetry.VerticalSpeed_cms = value; break;
+    case HUB_VOLTS_BP:      m_HubVoltageBP                = value; break;
+    case HUB_VOLTS_AP:      m_Telemetry.Voltage_dV        = m_HubVoltageBP*10 + value; break;
+    case HUB_CELL:
+    {
+      // big endian: cell index in the top nibble, 12 bit value in 2mV steps
+      uint8_t cell = (value >> 4) & 0x0F;
+      if (cell < T5X_FRSKY_HUB_CELLS) m_Telemetry.Cell_mV[cell] = (((value & 0x0F) << 8) | (value >> 8)) << 1;
+      break;
+    }
+  }
+}
+
 
 } // namespace end
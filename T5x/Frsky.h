@@ -1,26 +1,70 @@
-#include <arduino.h>
+#ifndef FRSKY_H
+#define FRSKY_H
+
+#include <Arduino.h>
 
 namespace t5x
 {
 
-#define T5X_FRSKY_TELEMETRY_FRAMESIZE 11
+#define T5X_FRSKY_TELEMETRY_FRAMESIZE 9   // frame type plus 8 data bytes, between the 0x7E delimiters
+#define T5X_FRSKY_HUB_CELLS           6
 
-class Frsky 
+// Decoded FrSky D telemetry, the decoder writes the values straight into this struct.
+// Hub values are only valid when the receiver is connected to a FrSky hub or sensor.
+typedef struct
+{
+  // 0xFE link frame
+  uint8_t       A1_Voltage;           // raw, 0-255
+  uint8_t       A2_Voltage;           // raw, 0-255
+  uint8_t       RSSI_Rx;              // raw, 0-255
+  uint8_t       RSSI_Tx;              // raw, 0-255
+
+  // 0xFD user data frames carrying the FrSky hub protocol
+  uint16_t      Voltage_dV;           // FAS voltage in 0.1V
+  uint16_t      Current_dA;           // FAS current in 0.1A
+  uint16_t      Cell_mV[T5X_FRSKY_HUB_CELLS]; // FLVS cell voltages in mV
+  int16_t       Altitude_m;           // vario barometric altitude
+  int16_t       VerticalSpeed_cms;    // vario vertical speed in cm/s
+  int16_t       GPSAltitude_m;
+  uint16_t      GPSSpeed_kn;          // knots
+  uint16_t      GPSCourse_deg;
+  uint16_t      Latitude_BP;          // ddmm
+  uint16_t      Latitude_AP;          // .mmmm
+  char          Latitude_NS;          // 'N' or 'S'
+  uint16_t      Longitude_BP;         // dddmm
+  uint16_t      Longitude_AP;         // .mmmm
+  char          Longitude_EW;         // 'E' or 'W'
+} FrskyTelemetry_t;
+
+class Frsky
 {
   public:
     Frsky();
-    
-    void            update();
+
+    boolean         update();         // true if a new link frame was decoded
+    boolean         decode(uint8_t b);// one byte from the serial link, true if it completed a link frame
+    void            resync()          { m_Counter = 0xFF; }   // drop the current frame, wait for the next 0x7E
     const boolean   TelemetryLinkAlive();
-  
-    uint8_t         m_A1_Voltage;
-    uint8_t         m_A2_Voltage;
-    uint8_t         m_RSSI;
+
+    FrskyTelemetry_t m_Telemetry;
 
   private:
+    boolean         decodeFrame();
+    void            decodeHub(uint8_t b);
+    void            decodeHubValue(uint16_t value);
+
     uint8_t         m_Data[T5X_FRSKY_TELEMETRY_FRAMESIZE];
-    uint8_t         m_Counter;
+    uint8_t         m_Counter;        // bytes received since the last 0x7E, 0xFF while waiting for one
+    boolean         m_Escape;         // last byte was 0x7D
     unsigned long   m_LastValidFrameMillis;
+
+    uint8_t         m_HubState;       // position in the current hub packet
+    boolean         m_HubEscape;      // last hub byte was 0x5D
+    uint8_t         m_HubId;
+    uint8_t         m_HubLow;
+    uint16_t        m_HubVoltageBP;   // voltage before the decimal point, waits for the part after it
 };
 
 } // namespace end
+
+#endif
@@ -1,9 +1,8 @@
 #include "Profile.h"
 #include "config.h"
 #include "util.h"
-
-#define T5X_PROFILE_EEPROM_STARTADDR      192    // EEPROM address-range 192 -> 192+9*88=984 is reserved for storing of profiles
-#define T5X_PROFILE_EEPROM_RESERVED_BYTES  88    // 88 bytes per profile reserved, 9 profiles
+#include "EEPROMQueue.h"
+#include "Protocol.h"
 
 
 namespace t5x
@@ -12,7 +11,10 @@ namespace t5x
 void Profile::load(uint8_t aProfileId=0)
 {
 #ifdef T5X_USE_EEPROM
-  EEPROM_readAnything(T5X_PROFILE_EEPROM_STARTADDR+aProfileId*T5X_PROFILE_EEPROM_RESERVED_BYTES, m_Data); 
+  EEPROMQueue::flush();   // m_Data is about to change and may still be queued
+  uint8_t length  = 0;
+  uint8_t version = readRecord(T5X_PROFILE_EEPROM_STARTADDR+aProfileId*T5X_PROFILE_EEPROM_RESERVED_BYTES, &m_Data, sizeof(m_Data), length);
+  if (version == 0 || !migrate(version, length)) m_Data = gDefaultProfile;
 #else
   m_Data = gDefaultProfile;
 #endif
@@ -23,41 +25,57 @@ void Profile::load(uint8_t aProfileId=0)
 void Profile::save(uint8_t aProfileId=0)
 {
 #ifdef T5X_USE_EEPROM
-  EEPROM_writeAnything(T5X_PROFILE_EEPROM_STARTADDR+aProfileId*T5X_PROFILE_EEPROM_RESERVED_BYTES, m_Data); 
+  writeRecord(T5X_PROFILE_EEPROM_STARTADDR+aProfileId*T5X_PROFILE_EEPROM_RESERVED_BYTES, m_Header, T5X_PROFILE_VERSION, &m_Data, sizeof(m_Data)); 
 #endif
 }
 
 
-void Profile::init()
+boolean Profile::migrate(uint8_t aVersion, uint8_t aLength)
 {
-#ifdef T5X_CONDITIONAL_INITIALIZE_EEPROM
-  for(int i=0;i<9;i++)
+  if (aVersion == 1)
   {
-    EEPROM_writeAnything(T5X_PROFILE_EEPROM_STARTADDR+i*T5X_PROFILE_EEPROM_RESERVED_BYTES, gDefaultProfile); 
-  } 
-#endif  
+    if (aLength != T5X_PROFILE_V1_LENGTH) return false;
+    // everything up to ChannelOrder[9] is at the same place
+    memset(m_Data.ChannelOrder+9, 0, sizeof(m_Data.ChannelOrder)-9);
+    m_Data.ChannelCount = strlen(m_Data.ChannelOrder);
+    aVersion = 2;
+    aLength  = sizeof(m_Data);
+  }
+  return aVersion == T5X_PROFILE_VERSION && aLength == sizeof(m_Data);
+}
+
+
+void Profile::migrateLegacy(uint8_t aEEPROMVersion)
+{
+  uint8_t version = aEEPROMVersion == 0x01 ? 1 : 2;
+  uint8_t length  = version == 1 ? T5X_PROFILE_V1_LENGTH : sizeof(m_Data);
+  for (uint8_t i=0; i<9; i++)
+  {
+    uint16_t address = T5X_PROFILE_EEPROM_STARTADDR+i*T5X_PROFILE_EEPROM_RESERVED_BYTES;
+    for (uint8_t j=0; j<length; j++) ((uint8_t*)&m_Data)[j] = EEPROM.read(address+j);
+    if (!migrate(version, length)) m_Data = gDefaultProfile;
+    save(i);
+    EEPROMQueue::flush();   // m_Data is reused for the next profile
+  }
 }
 
 void Profile::send()
 {
-    Serial.write(T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE1);     // MsgPreamble
-    Serial.write(T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE2);     // MsgPreamble
-    Serial.write(T5X_MSG_PROFILE_DATA_INFO_MSGID);          // MsgId
-    
-    
-    char tBuffer[sizeof(m_Data)];
-    memcpy(tBuffer, &m_Data,sizeof(m_Data));
-    
-    for (int i=0;i<sizeof(m_Data);i++)
-    {
-      Serial.write(tBuffer[i]);
-    }    
- 
+    gProtocol.send(T5X_MSG_PROFILE_DATA_INFO_MSGID, &m_Data, sizeof(m_Data));
+}
+
+void Profile::receive(const byte aData[])
+{
+  EEPROMQueue::flush();   // m_Data is about to change and may still be queued
+  memcpy(&m_Data, aData, sizeof(m_Data));
 }
 
-void Profile::receive(byte aMsg[])
+boolean Profile::patch(uint8_t aOffset, const byte aData[], uint8_t aLength)
 {
-  memcpy(&m_Data, aMsg+3,sizeof(m_Data));
+  if (aOffset > sizeof(m_Data) || aLength > sizeof(m_Data) - aOffset) return false;
+  EEPROMQueue::flush();
+  memcpy((uint8_t*)&m_Data + aOffset, aData, aLength);
+  return true;
 }
 
 } // namespace end
@@ -1,8 +1,9 @@
 #ifndef PROFILE_H
 #define PROFILE_H
 
-#include <arduino.h>
+#include <Arduino.h>
 #include "config.h"
+#include "util.h"
 
 namespace t5x
 {
@@ -21,9 +22,17 @@ typedef struct
     uint8_t       V_A1[3];    
     uint8_t       V_A2[3];
     uint16_t      Timer;
-    char          ChannelOrder[9];
+    char          ChannelOrder[13];
+    uint8_t       ChannelCount;   // channels sent via PPM [4-12]
 } Profile_t;
 
+#define T5X_PROFILE_VERSION     2       // layout version of Profile_t, increase when it changes and extend Profile::migrate()
+#define T5X_PROFILE_V1_LENGTH   53      // version 1: ChannelOrder[9], no ChannelCount
+
+#define T5X_PROFILE_EEPROM_STARTADDR      192    // EEPROM address-range 192 -> 192+9*88=984 is reserved for storing of profiles
+#define T5X_PROFILE_EEPROM_RESERVED_BYTES  88    // 88 bytes per profile reserved, 9 profiles, each holds a record header and Profile_t
+#define T5X_PROFILE_COUNT                   9
+
 
 
 class Profile 
@@ -33,16 +42,20 @@ class Profile
     uint8_t m_Id;
  
     void send();                    // send profile settings via serial to application
-    void receive(byte aMsg[]);      // decode the received byte array 
-    void init();                    // initialize profile data in EEPROM with default values
-    void load(uint8_t aProfileId);  // load given profile id from EEPROM to RAM
+    void receive(const byte aData[]); // take over the payload of a received message
+    boolean patch(uint8_t aOffset, const byte aData[], uint8_t aLength); // overwrite part of m_Data, false if out of range
+    void load(uint8_t aProfileId);  // load given profile id from EEPROM to RAM, defaults if the record is invalid
     void save(uint8_t aProfileId);  // save profile to EEPROM
+    void migrateLegacy(uint8_t aEEPROMVersion); // convert all profiles stored without record header
 
   private:
+    boolean migrate(uint8_t aVersion, uint8_t aLength);  // bring m_Data from an older layout to the current one
+
+    RecordHeader_t m_Header;        // written along with m_Data
 };
 
 
-#if defined(T5X_CONDITIONAL_INITIALIZE_EEPROM) || not defined(T5X_USE_EEPROM)
+// used for profiles without a valid record
 static const t5x::Profile_t gDefaultProfile =
 { 
   { 30, 50, 70,  0,  0,  0},  // AILERON EXPO [-100/+100]     Flight Mode 1 2 3 4 5 6
@@ -56,9 +69,9 @@ static const t5x::Profile_t gDefaultProfile =
   {2, 35, 33},                // TELEMETRY A1 VOLTAGE Warning Level ORANGE, RED
   {0, 0, 0},                  // TELEMETRY A2 VOLTAGE Warning Level ORANGE, RED (Note: without divider 0-3,3V in 255 steps or 0,013V per step)  
   420,                        // FLIGHT TIMER (seconds)
-  "AETR123P"                  // Channel Order AIL, ELE, TRH, RUD, AUX1 (SW1), AUX2 (SW2), AUX3 (SW3), AUX4 (POT1)
+  "AETR123P",                 // Channel Order AIL, ELE, TRH, RUD, AUX1 (SW1), AUX2 (SW2), AUX3 (SW3), AUX4 (POT1)
+  8                           // Channel Count [4-12]
 };
-#endif
 
 } // namespace
 #endif
@@ -0,0 +1,206 @@
+#include "Protocol.h"
+#include "Profile.h"
+#include "TxDeviceProperties.h"
+#include "util.h"
+
+
+namespace t5x
+{
+
+Protocol gProtocol;
+
+
+enum
+{
+  State_Preamble1,
+  State_Preamble2,
+  State_V1MsgId,
+  State_V1Payload,
+  State_Seq,
+  State_MsgId,
+  State_Length,
+  State_Payload,
+  State_CRCLow,
+  State_CRCHigh
+};
+
+
+// payload length of a v1 message, 0 if the message id is not known.
+// requests have no payload in v1 either, but the TX waited for one more byte before answering them.
+static uint8_t v1Length(uint8_t aMsgId)
+{
+  switch (aMsgId)
+  {
+    case T5X_MSG_PROFILE_DATA_APPLY_MSGID:        return sizeof(Profile_t);
+    case T5X_MSG_TXDEVICE_PROPERTIES_APPLY_MSGID: return sizeof(T5xDeviceProperties_t);
+    case T5X_MSG_BAUD_RATE_REQ_MSGID:             return sizeof(uint32_t);
+    case T5X_MSG_REALTIME_SUBSCRIBE_MSGID:        return sizeof(uint16_t)+1;
+    case T5X_MSG_PROFILE_DATA_REQ_MSGID:
+    case T5X_MSG_TXDEVICE_PROPERTIES_REQ_MSGID:
+    case T5X_MSG_SAVE_CONFIG_TO_EEPROM_MSGID:
+    case T5X_MSG_PROFILE_SELECT_MSGID:
+    case T5X_MSG_BULK_EXPORT_REQ_MSGID:           return 1;
+  }
+  return 0;
+}
+
+
+Protocol::Protocol()
+:m_State(State_Preamble1), m_MsgId(0), m_Length(0), m_Count(0), m_Seq(0), m_CRC(0),
+ m_LastSeq(0), m_LastSeqValid(false), m_Framed(false), m_Repeat(false), m_FramedPeer(false), m_FramedOnly(false), m_TxSeq(0), m_TxCRC(0)
+{
+}
+
+
+boolean Protocol::parse(uint8_t b)
+{
+  switch (m_State)
+  {
+    case State_Preamble1:
+      if (b == T5X_MSG_CONFIGURATOR_TO_TX_PREAMBLE1) m_State = State_Preamble2;
+      break;
+
+    case State_Preamble2:
+      if      (b == T5X_MSG_CONFIGURATOR_TO_TX_PREAMBLE2 && !m_FramedOnly) m_State = State_V1MsgId;
+      else if (b == T5X_MSG_CONFIGURATOR_TO_TX_FRAMED_PREAMBLE2)         m_State = State_Seq;
+      else                                                               m_State = State_Preamble1;
+      break;
+
+    case State_V1MsgId:
+      m_Length = v1Length(b);
+      if (m_Length == 0)
+      {
+        m_State = State_Preamble1;
+        break;
+      }
+      m_MsgId  = b;
+      m_Count  = 0;
+      m_State  = State_V1Payload;
+      break;
+
+    case State_V1Payload:
+      m_Buffer[m_Count++] = b;
+      if (m_Count < m_Length) break;
+      m_State  = State_Preamble1;
+      m_Framed = m_FramedPeer = false;    // an old configurator, answer it in v1
+      m_Repeat = false;
+      return true;
+
+    case State_Seq:
+      m_Seq   = b;
+      m_CRC   = crc16(0xFFFF, &b, 1);
+      m_State = State_MsgId;
+      break;
+
+    case State_MsgId:
+      m_MsgId = b;
+      m_CRC   = crc16(m_CRC, &b, 1);
+      m_State = State_Length;
+      break;
+
+    case State_Length:
+      m_Length = b;
+      m_Count  = 0;
+      m_CRC    = crc16(m_CRC, &b, 1);
+      if (m_Length > T5X_PROTOCOL_MAX_PAYLOAD)
+      {
+        m_State  = State_Preamble1;
+        m_Framed = m_FramedPeer = true;
+        if (!m_FramedOnly) nak(T5X_NAK_LENGTH);   // when shared with telemetry, this may not have been a frame at all
+        break;
+      }
+      m_State = m_Length ? State_Payload : State_CRCLow;
+      break;
+
+    case State_Payload:
+      m_Buffer[m_Count++] = b;
+      m_CRC = crc16(m_CRC, &b, 1);
+      if (m_Count == m_Length) m_State = State_CRCLow;
+      break;
+
+    case State_CRCLow:
+      m_CRC  ^= b;                        // both bytes are zero when the CRC matches
+      m_State = State_CRCHigh;
+      break;
+
+    case State_CRCHigh:
+      m_CRC  ^= uint16_t(b) << 8;
+      m_State = State_Preamble1;
+      m_Framed = m_FramedPeer = true;
+      if (m_CRC != 0)
+      {
+        if (!m_FramedOnly) nak(T5X_NAK_CRC);
+        break;
+      }
+      m_Repeat = m_LastSeqValid && m_Seq == m_LastSeq;
+      return true;
+  }
+  return false;
+}
+
+
+void Protocol::ack()
+{
+  if (!m_Framed) return;
+  m_LastSeq      = m_Seq;
+  m_LastSeqValid = true;
+  send(T5X_MSG_ACK_INFO_MSGID, &m_Seq, 1);
+}
+
+
+void Protocol::nak(uint8_t aReason)
+{
+  if (!m_Framed) return;
+  uint8_t data[2] = {m_Seq, aReason};
+  send(T5X_MSG_NAK_INFO_MSGID, data, sizeof(data));
+}
+
+
+void Protocol::send(uint8_t aMsgId, const void* aData, uint8_t aLength)
+{
+  sendBegin(aMsgId, aLength);
+  sendData(aData, aLength);
+  sendEnd();
+}
+
+
+int Protocol::writable()
+{
+#ifdef SERIAL_TX_BUFFER_SIZE
+  return Serial.availableForWrite();
+#else
+  return 0x7FFF;   // cores without a transmit buffer size can't tell, whole messages are sent and may wait
+#endif
+}
+
+
+// the message is handed to the serial transmit buffer in blocks, straight from where it lives
+void Protocol::sendBegin(uint8_t aMsgId, uint8_t aLength)
+{
+  if (m_FramedPeer)
+  {
+    uint8_t header[5] = {T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE1, T5X_MSG_TX_TO_CONFIGURATOR_FRAMED_PREAMBLE2, m_TxSeq++, aMsgId, aLength};
+    m_TxCRC = crc16(0xFFFF, header+2, 3);
+    Serial.write(header, sizeof(header));
+  }
+  else
+  {
+    uint8_t header[3] = {T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE1, T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE2, aMsgId};
+    Serial.write(header, sizeof(header));
+  }
+}
+
+
+void Protocol::sendData(const void* aData, uint8_t aLength)
+{
+  if (m_FramedPeer) m_TxCRC = crc16(m_TxCRC, aData, aLength);
+  Serial.write(static_cast<const uint8_t*>(aData), aLength);
+}
+
+
+void Protocol::sendEnd()
+{
+  if (m_FramedPeer) Serial.write(reinterpret_cast<const uint8_t*>(&m_TxCRC), sizeof(m_TxCRC));
+}
+
+} // namespace end
@@ -0,0 +1,74 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+namespace t5x
+{
+
+#define T5X_PROTOCOL_MAX_PAYLOAD 100   // largest message, a Profile_t or T5xDeviceProperties_t fits
+
+// NAK reasons
+#define T5X_NAK_CRC              0x01  // frame was damaged, send it again
+#define T5X_NAK_LENGTH           0x02  // payload is too long or does not fit the message
+#define T5X_NAK_UNKNOWN          0x03  // message id is not known
+#define T5X_NAK_MODE             0x04  // message is not handled in normal operating mode
+
+#define T5X_PROTOCOL_REPLY_SIZE  9     // a NAK in a v2 frame, the longest answer that is sent in normal operating mode
+
+// Messages between configurator and TX. Two protocols are understood on the same stream:
+//  v1:  FE FE MsgId Payload                          the length of the payload is implied by MsgId
+//  v2:  FE FD Seq MsgId Length Payload CRC16         CRC-16/CCITT over Seq to the end of the payload, low byte first
+// Every v2 frame is answered with an ACK or NAK carrying its Seq. The configurator sends a frame again with the
+// same Seq if it gets a NAK or no answer; a repeated frame that was already acknowledged is not executed twice.
+// The TX answers in the protocol the configurator used last, so existing configurators see no difference.
+class Protocol
+{
+  public:
+    Protocol();
+
+    boolean         parse(uint8_t b);     // true when a complete message is ready, valid until the next call
+
+    uint8_t         msgId()    { return m_MsgId;  }
+    uint8_t         length()   { return m_Length; }
+    const uint8_t*  payload()  { return m_Buffer; }
+    boolean         isRepeat() { return m_Repeat; }    // v2 frame that was acknowledged before, the ACK got lost
+
+    void            setFramedOnly(boolean aFramedOnly) { m_FramedOnly = aFramedOnly; }   // ignore v1 messages, they have no CRC
+
+    void            ack();                // accept the current message, v2 only
+    void            nak(uint8_t aReason); // reject the current message, v2 only
+
+    void            send(uint8_t aMsgId, const void* aData, uint8_t aLength);   // one message to the configurator
+
+    // a message put together from several pieces, their lengths have to add up to aLength
+    void            sendBegin(uint8_t aMsgId, uint8_t aLength);
+    void            sendData(const void* aData, uint8_t aLength);
+    void            sendEnd();
+    uint8_t         overhead() { return m_FramedPeer ? 7 : 3; }   // bytes a message takes on top of its payload
+    int             writable();           // bytes the serial transmit buffer takes without waiting
+
+  private:
+    uint8_t         m_State;
+    uint8_t         m_MsgId;
+    uint8_t         m_Length;
+    uint8_t         m_Count;              // payload bytes received
+    uint8_t         m_Seq;
+    uint16_t        m_CRC;
+    uint8_t         m_LastSeq;            // Seq of the last acknowledged frame
+    boolean         m_LastSeqValid;
+    boolean         m_Framed;             // the current message came in a v2 frame
+    boolean         m_Repeat;
+    boolean         m_FramedPeer;         // configurator talks v2, answer in v2
+    boolean         m_FramedOnly;
+    uint8_t         m_TxSeq;              // Seq of the next frame to the configurator
+    uint16_t        m_TxCRC;              // of the frame being sent
+    uint8_t         m_Buffer[T5X_PROTOCOL_MAX_PAYLOAD];
+};
+
+extern Protocol gProtocol;
+
+} // namespace end
+
+#endif
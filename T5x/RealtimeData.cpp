@@ -1,24 +1,86 @@
 #include "RealtimeData.h"
+#include "Protocol.h"
+#include "util.h"
+
+#include <stddef.h>
+#include <avr/pgmspace.h>
 
 namespace t5x
 {
-  
+
+#define T5X_REALTIME_FIELD(field) {offsetof(RealtimeData_t, field), sizeof(((RealtimeData_t*)0)->field)}
+
+// offset and size of each RealtimeField_
+static const uint8_t PROGMEM sc_fields[RealtimeFieldCount][2] =
+{
+  T5X_REALTIME_FIELD(Analog),
+  T5X_REALTIME_FIELD(Channel_us),
+  {offsetof(RealtimeData_t, SwitchState), sizeof(((RealtimeData_t*)0)->SwitchState)+2},   // up to FlightMode
+  T5X_REALTIME_FIELD(FreeRAM),
+  T5X_REALTIME_FIELD(LoopTime),
+  T5X_REALTIME_FIELD(FlightTimerSec),
+  T5X_REALTIME_FIELD(PPMLatency),
+  T5X_REALTIME_FIELD(TaskWorstCase_us),
+  T5X_REALTIME_FIELD(TaskDeadlineMisses),
+  T5X_REALTIME_FIELD(BootTime),
+  T5X_REALTIME_FIELD(ProfileSwitchTime)
+};
+
+
+RealtimeData::RealtimeData()
+:m_Subscribed(false), m_Mask(0), m_Pending(0)
+{
+}
+
 
 void RealtimeData::send()
 {
-    Serial.write(T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE1);     // MsgPreamble
-    Serial.write(T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE2);     // MsgPreamble
-    Serial.write(T5X_MSG_REALTIME_DATA_INFO_MSGID);         // MsgId
-    
-    char tBuffer[sizeof(m_Data)];
-    
-    memcpy(tBuffer, &m_Data,sizeof(m_Data));
+    gProtocol.send(T5X_MSG_REALTIME_DATA_INFO_MSGID, &m_Data, sizeof(m_Data));
+}
+
+
+void RealtimeData::subscribe(uint16_t aMask)
+{
+    m_Subscribed = true;
+    m_Mask       = aMask & ((1 << RealtimeFieldCount) - 1);
+    m_Pending    = m_Mask;
+}
+
+
+void RealtimeData::sendChanges()
+{
+    // the message is the mask of the fields it carries, followed by these fields in the order of RealtimeData_t
+    // room for an ACK or NAK is left, so answering the configurator never waits either
+    int space = gProtocol.writable() - T5X_PROTOCOL_REPLY_SIZE - gProtocol.overhead() - sizeof(uint16_t);
     
-    for (int i=0;i<sizeof(m_Data);i++)
+    uint16_t mask   = 0;
+    uint8_t  length = sizeof(mask);
+    uint16_t crc[RealtimeFieldCount];
+    for (uint8_t i=0; i<RealtimeFieldCount; i++)
+    {
+      if (!(m_Mask & (1 << i))) continue;
+      
+      uint8_t size = pgm_read_byte(&sc_fields[i][1]);
+      crc[i] = crc16(0xFFFF, (const uint8_t*)&m_Data + pgm_read_byte(&sc_fields[i][0]), size);
+      if (crc[i] == m_SentCRC[i] && !(m_Pending & (1 << i))) continue;
+      if (size > space) continue;   // next time
+      
+      mask   |= 1 << i;
+      length += size;
+      space  -= size;
+    }
+    if (mask == 0) return;
+
+    gProtocol.sendBegin(T5X_MSG_REALTIME_DELTA_INFO_MSGID, length);
+    gProtocol.sendData(&mask, sizeof(mask));
+    for (uint8_t i=0; i<RealtimeFieldCount; i++)
     {
-//      Serial.write((char*)&m_Data+i);  
-      Serial.write(tBuffer[i]);
-    }        
+      if (!(mask & (1 << i))) continue;
+      gProtocol.sendData((const uint8_t*)&m_Data + pgm_read_byte(&sc_fields[i][0]), pgm_read_byte(&sc_fields[i][1]));
+      m_SentCRC[i] = crc[i];
+    }
+    gProtocol.sendEnd();
+    m_Pending &= ~mask;
 }
 
 
@@ -1,8 +1,9 @@
 #ifndef REALTIMEDATA_H
 #define REALTIMEDATA_H
 
-#include <arduino.h>
+#include <Arduino.h>
 #include "config.h"
+#include "Scheduler.h"
 
 namespace t5x
 {
@@ -10,24 +11,58 @@ namespace t5x
 typedef struct
 {
   uint16_t      Analog[8];
-  uint16_t      Channel_us[8];
+  uint16_t      Channel_us[12];
   uint8_t       SwitchState[3];  // SW1, SW2, SW3
   uint8_t       ProfileId;
   uint8_t       FlightMode;
   uint16_t      FreeRAM;
   uint16_t      LoopTime;
   int16_t       FlightTimerSec;
+  uint16_t      PPMLatency;      // age of the channel values in us when PPMOut latched them for the last frame
+  uint16_t      TaskWorstCase_us[T5X_MAX_TASKS];   // longest run time of each scheduler task
+  uint8_t       TaskDeadlineMisses[T5X_MAX_TASKS]; // times each task started later than its deadline, saturates at 255
+  uint16_t      BootTime;        // milliseconds from power on until the first live stick values went to PPMOut
+  uint16_t      ProfileSwitchTime; // milliseconds from the request until the last profile switch was applied
 } RealtimeData_t;
+
+
+// fields of RealtimeData_t the configurator can subscribe to, bit n of the mask selects field n
+enum
+{
+  RealtimeField_Analog,
+  RealtimeField_Channel_us,
+  RealtimeField_Switches,         // SwitchState, ProfileId and FlightMode
+  RealtimeField_FreeRAM,
+  RealtimeField_LoopTime,
+  RealtimeField_FlightTimerSec,
+  RealtimeField_PPMLatency,
+  RealtimeField_TaskWorstCase_us,
+  RealtimeField_TaskDeadlineMisses,
+  RealtimeField_BootTime,
+  RealtimeField_ProfileSwitchTime,
+  RealtimeFieldCount
+};
   
   
 class RealtimeData 
 {
   public:  
     RealtimeData_t m_Data;
+
+    RealtimeData();
  
-    void send();                    // send profile settings via serial to application
+    void      send();                 // send all of m_Data via serial to application
+    
+    void      subscribe(uint16_t aMask);   // fields sendChanges() reports, all of them go out with the next call
+    boolean   isSubscribed() { return m_Subscribed; }
+    void      sendChanges();          // the subscribed fields that changed since they were last sent, as many as the
+                                      // serial transmit buffer takes without waiting. the rest follow with the next call.
 
   private:
+    boolean   m_Subscribed;
+    uint16_t  m_Mask;
+    uint16_t  m_Pending;              // fields to send no matter if they changed
+    uint16_t  m_SentCRC[RealtimeFieldCount];   // of each field when it was last sent
 };
   
   
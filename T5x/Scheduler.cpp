@@ -0,0 +1,69 @@
+#include "Scheduler.h"
+
+
+namespace t5x
+{
+
+Scheduler::Scheduler(const Task_t* aTasks, uint8_t aCount)
+:m_Tasks(aTasks), m_Count(aCount), m_Enabled(0)
+{
+  for (uint8_t i=0; i<T5X_MAX_TASKS; i++)
+  {
+    m_Due[i]       = 0;
+    m_WorstCase[i] = 0;
+    m_Misses[i]    = 0;
+  }
+}
+
+
+void Scheduler::enable(uint8_t aTask, boolean aEnable)
+{
+  if (aEnable)
+  {
+    m_Enabled |= 1<<aTask;
+    m_Due[aTask] = millis() + m_Tasks[aTask].Period;
+  }
+  else m_Enabled &= ~(1<<aTask);
+}
+
+
+void Scheduler::run(unsigned long aNow)
+{
+  boolean periodicRan = false;
+  for (uint8_t i=0; i<m_Count; i++)
+  {
+    if (!(m_Enabled & (1<<i))) continue;
+
+    if (m_Tasks[i].Period == 0)
+    {
+      execute(i);
+      continue;
+    }
+
+    unsigned long late = aNow - m_Due[i];
+    if ((long)late < 0) continue;
+
+    // the first due task runs, the others wait for a later pass until they reach their deadline
+    boolean overdue = late > m_Tasks[i].Deadline;
+    if (periodicRan && !overdue) continue;
+    if (overdue && m_Misses[i] < 0xFF) m_Misses[i]++;
+
+    // keep the cadence, but don't try to catch up on periods that are already over
+    m_Due[i] += m_Tasks[i].Period;
+    if ((long)(aNow - m_Due[i]) >= 0) m_Due[i] = aNow + m_Tasks[i].Period;
+
+    execute(i);
+    periodicRan = true;
+  }
+}
+
+
+void Scheduler::execute(uint8_t aTask)
+{
+  unsigned long start = micros();
+  m_Tasks[aTask].Function();
+  unsigned long duration = micros() - start;
+  if (duration > m_WorstCase[aTask]) m_WorstCase[aTask] = duration > 0xFFFF ? 0xFFFF : duration;
+}
+
+} // namespace end
@@ -0,0 +1,50 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+namespace t5x
+{
+
+#define T5X_MAX_TASKS 8   // one bit per task in m_Enabled
+
+typedef void (*TaskFunction_t)();
+
+// One entry of the static task table. The position in the table is the priority, first entry is highest.
+typedef struct
+{
+  TaskFunction_t  Function;
+  uint16_t        Period;      // milliseconds, 0 runs the task on every pass
+  uint16_t        Deadline;    // milliseconds a task may start late before it counts as a deadline miss
+} Task_t;
+
+// Cooperative scheduler, called from loop(): once per PPM frame with T5X_FRAME_SYNC_LEAD, on every pass of
+// loop() without it.
+// Every-pass tasks all run, of the periodic tasks that are due only the one with the highest priority runs,
+// so slow tasks are spread over passes and rarely add up in the same pass. A task that is past its deadline
+// runs in any case and counts a miss, so with long frames the low priority tasks still get their turn.
+class Scheduler
+{
+  public:
+    Scheduler(const Task_t* aTasks, uint8_t aCount);
+
+    void          enable(uint8_t aTask, boolean aEnable);
+    void          run(unsigned long aNow);
+
+    uint16_t      worstCase(uint8_t aTask) const { return m_WorstCase[aTask]; }   // microseconds
+    uint8_t       misses(uint8_t aTask) const    { return m_Misses[aTask]; }
+
+  private:
+    void          execute(uint8_t aTask);
+
+    const Task_t* m_Tasks;
+    uint8_t       m_Count;
+    uint8_t       m_Enabled;                    // one bit per task
+    unsigned long m_Due[T5X_MAX_TASKS];
+    uint16_t      m_WorstCase[T5X_MAX_TASKS];
+    uint8_t       m_Misses[T5X_MAX_TASKS];
+};
+
+} // namespace end
+
+#endif
@@ -0,0 +1,68 @@
+#include "StageTiming.h"
+#include "Protocol.h"
+
+#ifdef T5X_STAGE_TIMING
+
+namespace t5x
+{
+
+StageTiming gStageTiming;
+
+
+StageTiming::StageTiming()
+:m_Next(0)
+{
+  reset();
+}
+
+
+void StageTiming::reset()
+{
+  memset(&m_Data, 0, sizeof(m_Data));
+  for (uint8_t i=0; i<StageCount; i++) m_Data.Stage[i].Min = 0xFFFF;
+}
+
+
+void StageTiming::add(uint8_t aStage, uint16_t aTicks)
+{
+  StageStats_t& s = m_Data.Stage[aStage];
+
+  if (s.Min == 0xFFFF) s.Mean = aTicks;      // first run
+  else s.Mean += ((int32_t)aTicks - s.Mean) >> 4;
+  if (aTicks < s.Min) s.Min = aTicks;
+  if (aTicks > s.Max) s.Max = aTicks;
+
+  uint8_t  bucket = 0;
+  uint16_t limit  = 32;
+  while (bucket < T5X_STAGE_BUCKETS-1 && aTicks >= limit)
+  {
+    bucket++;
+    limit <<= 1;
+  }
+  if (s.Histogram[bucket] == 0xFF)
+  {
+    for (uint8_t i=0; i<T5X_STAGE_BUCKETS; i++) s.Histogram[i] >>= 1;
+  }
+  s.Histogram[bucket]++;
+}
+
+
+void StageTiming::sendNext()
+{
+    // all stages together are longer than the transmit buffer, so each stage is a message of its own:
+    // the stage number followed by its StageStats_t. room for an ACK or NAK is left, as for the realtime data
+    const uint8_t size = sizeof(uint8_t) + sizeof(StageStats_t) + gProtocol.overhead() + T5X_PROTOCOL_REPLY_SIZE;
+    for (uint8_t i=0; i<StageCount && gProtocol.writable() >= size; i++)
+    {
+      gProtocol.sendBegin(T5X_MSG_STAGE_TIMING_INFO_MSGID, sizeof(uint8_t) + sizeof(StageStats_t));
+      gProtocol.sendData(&m_Next, sizeof(m_Next));
+      gProtocol.sendData(&m_Data.Stage[m_Next], sizeof(StageStats_t));
+      gProtocol.sendEnd();
+      if (++m_Next == StageCount) m_Next = 0;
+    }
+}
+
+
+} // namespace end
+
+#endif
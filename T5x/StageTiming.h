@@ -0,0 +1,89 @@
+#ifndef STAGETIMING_H
+#define STAGETIMING_H
+
+#include <Arduino.h>
+#include "config.h"
+
+namespace t5x
+{
+
+enum Stage_t
+{
+  Stage_Switches,
+  Stage_ADC,
+  Stage_ExpoDR,
+  Stage_Pipes,
+  Stage_Channels,
+  Stage_PPMOut,
+  Stage_Frsky,
+  Stage_Serial,
+  StageCount
+};
+
+#define T5X_STAGE_BUCKETS 8
+
+typedef struct
+{
+  uint16_t      Min;                          // Timer1 ticks of 0.5us
+  uint16_t      Max;                          // Timer1 ticks of 0.5us
+  uint16_t      Mean;                         // Timer1 ticks of 0.5us, running average over about 16 runs
+  uint8_t       Histogram[T5X_STAGE_BUCKETS]; // bucket n counts runs below 32<<n ticks (16us<<n), the last one all longer runs.
+                                              // all buckets are halved when one is full, so the shape is kept
+} StageStats_t;
+
+typedef struct
+{
+  StageStats_t  Stage[StageCount];
+} StageTimingData_t;
+
+
+class StageTiming
+{
+  public:
+    StageTimingData_t m_Data;
+
+    StageTiming();
+
+    void          add(uint8_t aStage, uint16_t aTicks);
+    void          reset();
+    void          sendNext();         // send the stages that fit the serial transmit buffer without waiting,
+                                      // one message each. the next call continues with the stage after them.
+
+    static uint16_t ticks()           // TCNT1, read atomically as the PPMOut interrupt uses the 16 bit timer registers too
+    {
+      uint8_t oldSREG = SREG;
+      cli();
+      uint16_t t = TCNT1;
+      SREG = oldSREG;
+      return t;
+    }
+
+  private:
+    uint8_t       m_Next;             // stage sendNext() continues with
+};
+
+extern StageTiming gStageTiming;
+
+
+// measures the run time of the enclosing scope
+class StageScope
+{
+  public:
+    StageScope(uint8_t aStage) : m_Stage(aStage), m_Start(StageTiming::ticks()) {}
+    ~StageScope() { gStageTiming.add(m_Stage, StageTiming::ticks() - m_Start); }
+
+  private:
+    uint8_t       m_Stage;
+    uint16_t      m_Start;
+};
+
+} // namespace end
+
+
+#ifdef T5X_STAGE_TIMING
+#define T5X_STAGE(aStage) t5x::StageScope tStageScope(t5x::aStage)
+#else
+#define T5X_STAGE(aStage)
+#endif
+
+#endif
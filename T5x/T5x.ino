@@ -29,23 +29,27 @@
   *                                                                             
   *****************************************************************************/
 
+#include <ADCSampler.h>
 #include <AIPin.h>
 #include <BiStateSwitch.h>
 #include <TriStateSwitch.h>
+#include <SwitchBank.h>
 #include <AnalogSwitch.h>
 #include <Channel.h>
 #include <DualRates.h>
 #include <Expo.h>
 #include <InputToOutputPipe.h>
 #include <PPMOut.h>
+#include <ResponseTable.h>
 #include <ThrottleHold.h>
 #include <Timer1.h>
 #include <util.h>
 #include <Buzzer.h>
 #include <Timer2.h>
 #include <FlightTimer.h>
-#include <arduino.h>
+#include <Arduino.h>
 #include <EEPROM.h>
+#include <stddef.h>     // offsetof
 
 // t5x includes
 #include "TxDeviceProperties.h"
@@ -53,6 +57,12 @@
 #include "RealtimeData.h"
 #include "config.h"
 #include "Frsky.h"
+#include "Alarm.h"
+#include "Scheduler.h"
+#include "StageTiming.h"
+#include "EEPROMQueue.h"
+#include "Protocol.h"
+#include "BulkTransfer.h"
 #include "util.h"
 
 
@@ -60,7 +70,7 @@
 ///////////////////////////////////////////////////////////////////////
 // Transmitter Settings
 ///////////////////////////////////////////////////////////////////////
-enum {ChannelCount = 8};
+enum {MaxChannelCount = 12};   // the profile decides how many of these are actually sent, see Profile_t::ChannelCount
 
 /////////// Analog Pins /////////////
 rc::AIPin g_aPins[4] = 
@@ -85,16 +95,17 @@ rc::AnalogSwitch   g_AnalogSW2(rc::Switch_B, rc::Input_SW2);
 rc::TriStateSwitch g_SW3(6, 7, rc::Switch_C);
 rc::AnalogSwitch   g_AnalogSW3(rc::Switch_C, rc::Input_SW3);
 
+rc::SwitchBank     g_SwitchBank(&PIND, 0xF8);  // pins 3-7 are PD3-PD7, all switches are read and debounced at once
+boolean            gSwitchesStale = true;      // switch states have to be worked out again, even if no pin changed
 
-///////////// EXPO /////////////////
-rc::Expo g_ailExpo[6] = {rc::Expo(0, rc::Input_AIL), rc::Expo(0, rc::Input_AIL), rc::Expo(0, rc::Input_AIL), rc::Expo(0, rc::Input_AIL), rc::Expo(0, rc::Input_AIL), rc::Expo(0, rc::Input_AIL)}; // also specify what index of the input
-rc::Expo g_eleExpo[6] = {rc::Expo(0, rc::Input_ELE), rc::Expo(0, rc::Input_ELE), rc::Expo(0, rc::Input_ELE), rc::Expo(0, rc::Input_ELE), rc::Expo(0, rc::Input_ELE), rc::Expo(0, rc::Input_ELE)}; // buffer the expo should work on 
-rc::Expo g_rudExpo[6] = {rc::Expo(0, rc::Input_RUD), rc::Expo(0, rc::Input_RUD), rc::Expo(0, rc::Input_RUD), rc::Expo(0, rc::Input_RUD), rc::Expo(0, rc::Input_RUD), rc::Expo(0, rc::Input_RUD)};
 
-/////////// Dual Rate //////////////
-rc::DualRates g_ailDR[6] = {rc::DualRates(100, rc::Input_AIL), rc::DualRates(100, rc::Input_AIL), rc::DualRates(100, rc::Input_AIL), rc::DualRates(100, rc::Input_AIL), rc::DualRates(100, rc::Input_AIL), rc::DualRates(100, rc::Input_AIL)}; // also specify what index of the input
-rc::DualRates g_eleDR[6] = {rc::DualRates(100, rc::Input_ELE), rc::DualRates(100, rc::Input_ELE), rc::DualRates(100, rc::Input_ELE), rc::DualRates(100, rc::Input_ELE), rc::DualRates(100, rc::Input_ELE), rc::DualRates(100, rc::Input_ELE)}; // buffer the dual rates
-rc::DualRates g_rudDR[6] = {rc::DualRates(100, rc::Input_RUD), rc::DualRates(100, rc::Input_RUD), rc::DualRates(100, rc::Input_RUD), rc::DualRates(100, rc::Input_RUD), rc::DualRates(100, rc::Input_RUD), rc::DualRates(100, rc::Input_RUD)}; // should work on
+///////////// EXPO & DUAL RATE /////////////////
+// expo and dual rate of each flight mode are compiled into one response table per axis by applyProfile(),
+// after a profile switch by compileResponse() one flight mode at a time
+rc::ResponseTable g_ailResponse[6] = {rc::ResponseTable(rc::Input_AIL), rc::ResponseTable(rc::Input_AIL), rc::ResponseTable(rc::Input_AIL), rc::ResponseTable(rc::Input_AIL), rc::ResponseTable(rc::Input_AIL), rc::ResponseTable(rc::Input_AIL)}; // also specify what index of the input
+rc::ResponseTable g_eleResponse[6] = {rc::ResponseTable(rc::Input_ELE), rc::ResponseTable(rc::Input_ELE), rc::ResponseTable(rc::Input_ELE), rc::ResponseTable(rc::Input_ELE), rc::ResponseTable(rc::Input_ELE), rc::ResponseTable(rc::Input_ELE)}; // buffer the response should work on
+rc::ResponseTable g_rudResponse[6] = {rc::ResponseTable(rc::Input_RUD), rc::ResponseTable(rc::Input_RUD), rc::ResponseTable(rc::Input_RUD), rc::ResponseTable(rc::Input_RUD), rc::ResponseTable(rc::Input_RUD), rc::ResponseTable(rc::Input_RUD)};
+uint8_t           gResponseStale = 0;  // one bit per flight mode whose tables still hold the previous profile after a profile switch
 
 
 // Set up pipes for direct input to output copying
@@ -109,7 +120,7 @@ rc::InputToOutputPipe g_aux4(    rc::Input_POT1,rc::Output_AUX4); // Potentiomet
 
 
 ////////// Channel Order ///////////
-rc::Channel g_channels[ChannelCount] =
+rc::Channel g_channels[MaxChannelCount] =
 {
   	rc::Channel(rc::Output_None,  rc::OutputChannel_1),
 	rc::Channel(rc::Output_None,  rc::OutputChannel_2),
@@ -118,31 +129,64 @@ rc::Channel g_channels[ChannelCount] =
 	rc::Channel(rc::Output_None,  rc::OutputChannel_5),  
 	rc::Channel(rc::Output_None,  rc::OutputChannel_6),  
 	rc::Channel(rc::Output_None,  rc::OutputChannel_7),  
-        rc::Channel(rc::Output_None,  rc::OutputChannel_8)   
+        rc::Channel(rc::Output_None,  rc::OutputChannel_8),
+        rc::Channel(rc::Output_None,  rc::OutputChannel_9),
+        rc::Channel(rc::Output_None,  rc::OutputChannel_10),
+        rc::Channel(rc::Output_None,  rc::OutputChannel_11),
+        rc::Channel(rc::Output_None,  rc::OutputChannel_12)
 };
 
 // define PPM for the given amount of channels 
-rc::PPMOut g_PPMOut(ChannelCount);
+rc::PPMOut g_PPMOut(MaxChannelCount);
 
 
 ///////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////
 t5x::TxDeviceProperties gTxDevice;
 t5x::Profile            gProfile;
+t5x::Profile            gProfileStaging;        // next profile, loaded in the background by taskProfileSwitch
 t5x::RealtimeData       gRealtime;
 t5x::Frsky              g_Frsky;                // global frsky telemetry object 
 
+t5x::Alarm              g_TxVoltageAlarm;      // thresholds in raw ADC steps, set by applyDeviceSettings()
+t5x::Alarm              g_RSSIAlarm;           // thresholds in raw telemetry steps, set by applyDeviceSettings()
+t5x::Alarm              g_A1Alarm;             // thresholds in raw telemetry steps, set by applyProfile()
+t5x::Alarm              g_A2Alarm;             // thresholds in raw telemetry steps, set by applyProfile()
+boolean                 gTelemetryLinkAlive = false;
+
 rc::FlightTimer         gTimer;                // global flight timer
 int16_t                 gTimerSecAtPaused = 0; // to start a new timer after pause
 
 unsigned long           now                = 0; // for scheduling
 unsigned long           last               = 0; // measure loop time
-unsigned long           last_telemetry     = 0; // for scheduling
-unsigned long           last_flight_timer  = 0; // to create a new timer after pause
-unsigned long           last_realtime_data = 0; // for setup mode only
+unsigned long           last_telemetry     = 0; // repeats standing alarms every check interval
+int16_t                 gThrottle_us       = 0; // throttle channel of the last frame, drives the flight timer
 
-byte                    gRxBuffer[100];         // Receive Buffer
-uint8_t                 byteCount          = 0; // reveived bytes
+boolean                 gSaveReportPending = false; // configurator waits to hear when saving to EEPROM is done
+uint8_t                 gRealtimeInterval  = 60;    // ms between realtime data messages, set by the configurator's subscription
+unsigned long           gRealtimeSent      = 0;
+
+
+// serial link to the configurator. it starts at T5X_SERIAL_BAUD, the configurator may ask for a faster rate in setup mode.
+// the TX answers at the old rate and switches, then the configurator has to talk at the new rate within
+// T5X_SERIAL_CONFIRM_TIMEOUT and keep talking at least every T5X_SERIAL_LINK_TIMEOUT, otherwise the TX falls back.
+enum LinkState_t
+{
+  Link_Default,       // T5X_SERIAL_BAUD
+  Link_Switching,     // answer is going out at the old rate
+  Link_Confirming,    // waiting for the first message at the new rate
+  Link_Fast
+};
+LinkState_t             gLinkState    = Link_Default;
+uint32_t                gLinkBaud     = T5X_SERIAL_BAUD;
+unsigned long           gLinkSince    = 0;              // last message from the configurator, or start of the switch
+
+typedef struct
+{
+  uint32_t      Baud;             // rate used from now on, 0 if the asked rate is not possible
+  uint8_t       RxWindow;         // bytes the configurator may send before the TX reads them ...
+  uint8_t       PollInterval;     // ... every this many ms, so a fast link does not overrun the receive buffer
+} BaudRateInfo_t;
 
 
 enum OperatingMode_t
@@ -153,90 +197,308 @@ enum OperatingMode_t
 
 OperatingMode_t g_OperatingMode   = OperatingMode_Normal;
 
-int8_t getChannelPosition(char aChar)
-// return the channel position of the given character as per definition in the model profile
-// if not found, return -
+// the profile's channel order compiled into what loop() needs, so it doesn't have to deal with characters
+typedef struct
+{
+  rc::Output    Source[MaxChannelCount];// output feeding each channel
+  uint8_t       ChannelCount;           // channels to send [4-12]
+  int8_t        ThrottleChannel;        // channel carrying throttle, -1 if none
+  boolean       VirtualFlightMode;      // virtual flight mode switch is assigned to a channel
+} ChannelPlan_t;
+
+ChannelPlan_t gChannelPlan;
+ChannelPlan_t gChannelPlanStaging;      // plan of gProfileStaging, built by taskProfileSwitch before the switch
+
+void compileChannelPlan(const t5x::Profile_t& aProfile, ChannelPlan_t& aPlan)
 {
-  char* pChar = strchr(gProfile.m_Data.ChannelOrder, aChar);
-  if (pChar!=NULL) return int(pChar)-int(gProfile.m_Data.ChannelOrder);
-  else return -1;
+    aPlan.ThrottleChannel   = -1;
+    aPlan.VirtualFlightMode = false;
+    aPlan.ChannelCount      = constrain(aProfile.ChannelCount, 4, (uint8_t)MaxChannelCount);
+
+    for (uint8_t i = 0; i < aPlan.ChannelCount; ++i)
+    {
+      switch (aProfile.ChannelOrder[i])
+      {
+        case 'A':   aPlan.Source[i] = rc::Output_AIL1;                                 break;
+        case 'E':   aPlan.Source[i] = rc::Output_ELE1;                                 break;
+        case 'T':   aPlan.Source[i] = rc::Output_THR1; aPlan.ThrottleChannel = i;      break;
+        case 'R':   aPlan.Source[i] = rc::Output_RUD1;                                 break;
+        case '1':   aPlan.Source[i] = rc::Output_AUX1;                                 break;
+        case '2':   aPlan.Source[i] = rc::Output_AUX2;                                 break;
+        case '3':   aPlan.Source[i] = rc::Output_AUX3;                                 break;
+        case 'P':   aPlan.Source[i] = rc::Output_AUX4;                                 break;
+        case 'M':   aPlan.Source[i] = rc::Output_VFM;  aPlan.VirtualFlightMode = true; break;
+        default:    aPlan.Source[i] = rc::Output_NUL;                                          // '-' ensures empty channel remains 0
+      }
+    }
 }
 
 
+// hands gChannelPlan to the channels and PPMOut
+void applyChannelPlan()
+{
+    for (uint8_t i = 0; i < gChannelPlan.ChannelCount; ++i) g_channels[i].setSource(gChannelPlan.Source[i]);
+    g_PPMOut.setChannelCount(gChannelPlan.ChannelCount);
+    gSwitchesStale = true;  // virtual flight mode may have changed
+
+    // fill channel values buffer with same values, all centered, throttle low
+    for (uint8_t i = 0; i < MaxChannelCount; ++i) rc::setOutputChannel(rc::OutputChannel(i), rc::normalizedToMicros(0));
+    for (uint8_t i = gChannelPlan.ChannelCount; i < MaxChannelCount; ++i) gRealtime.m_Data.Channel_us[i]=0;   // not sent
+    if (gChannelPlan.ThrottleChannel>-1) rc::setOutputChannel(rc::OutputChannel(gChannelPlan.ThrottleChannel), rc::normalizedToMicros(-256));
+}
 
-void applyDeviceSettings()
+
+
+// converts an alarm level into a raw threshold, so that "raw < threshold" equals "raw*aDen < aNum"
+uint16_t rawThreshold(uint32_t aNum, uint32_t aDen)
+{
+    if (aDen==0) return aNum ? 0xFFFF : 0;
+    uint32_t t = (aNum + aDen - 1) / aDen;
+    return t > 0xFFFF ? 0xFFFF : t;
+}
+
+
+// true if a patch of aLength bytes at aOffset touches the aSize bytes at aField
+boolean patched(uint8_t aOffset, uint8_t aLength, uint8_t aField, uint8_t aSize)
+{
+    return aOffset < aField+aSize && aField < aOffset+aLength;
+}
+
+// true if a patch of aLength bytes at aOffset lies inside the aSize bytes at aField
+boolean within(uint8_t aOffset, uint8_t aLength, uint8_t aField, uint8_t aSize)
+{
+    return aOffset >= aField && aOffset+aLength <= aField+aSize;
+}
+
+#define T5X_DEVICE_FIELD(field)   offsetof(t5x::T5xDeviceProperties_t, field), sizeof(gTxDevice.m_Properties.field)
+#define T5X_PROFILE_FIELD(field)  offsetof(t5x::Profile_t, field), sizeof(gProfile.m_Data.field)
+
+
+// applies the part of the device settings that changed, everything else is read where it is used
+void applyDeviceSettings(uint8_t aOffset, uint8_t aLength)
 {
     // initialize switches working direction. maybe user wants to let them work in the other direction
-    g_SW1.setReverse(gTxDevice.m_Properties.SwitchSettings[0].Reverse);
-    g_SW2.setReverse(gTxDevice.m_Properties.SwitchSettings[1].Reverse);
-    g_SW3.setReverse(gTxDevice.m_Properties.SwitchSettings[2].Reverse);
+    gSwitchesStale = true;  // the direction or the switch that selects the flight mode may change
+    if (patched(aOffset, aLength, T5X_DEVICE_FIELD(SwitchSettings[0]))) g_SW1.setReverse(gTxDevice.m_Properties.SwitchSettings[0].Reverse);
+    if (patched(aOffset, aLength, T5X_DEVICE_FIELD(SwitchSettings[1]))) g_SW2.setReverse(gTxDevice.m_Properties.SwitchSettings[1].Reverse);
+    if (patched(aOffset, aLength, T5X_DEVICE_FIELD(SwitchSettings[2]))) g_SW3.setReverse(gTxDevice.m_Properties.SwitchSettings[2].Reverse);
     
     // set calibration values, these depend on hardware configurations
     for(int i=0; i<4; i++)  // calibrate/reverse gimbals for AIL, ELE, THR, RUD
     {
+        if (!patched(aOffset, aLength, offsetof(t5x::T5xDeviceProperties_t, AnalogSettings)+i*sizeof(gTxDevice.m_Properties.AnalogSettings[0]), sizeof(gTxDevice.m_Properties.AnalogSettings[0]))) continue;
         g_aPins[i].setCalibration(gTxDevice.m_Properties.AnalogSettings[i].Calibration[0], gTxDevice.m_Properties.AnalogSettings[i].Calibration[1],  gTxDevice.m_Properties.AnalogSettings[i].Calibration[2]);
         g_aPins[i].setReverse(gTxDevice.m_Properties.AnalogSettings[i].Reverse);  
 	}
 	
-    g_Pot1.setCalibration(gTxDevice.m_Properties.AnalogSettings[6].Calibration[0], gTxDevice.m_Properties.AnalogSettings[6].Calibration[1],  gTxDevice.m_Properties.AnalogSettings[6].Calibration[2]);
-    g_Pot1.setReverse(gTxDevice.m_Properties.AnalogSettings[6].Reverse);      
+    if (patched(aOffset, aLength, T5X_DEVICE_FIELD(AnalogSettings[6])))
+    {
+      g_Pot1.setCalibration(gTxDevice.m_Properties.AnalogSettings[6].Calibration[0], gTxDevice.m_Properties.AnalogSettings[6].Calibration[1],  gTxDevice.m_Properties.AnalogSettings[6].Calibration[2]);
+      g_Pot1.setReverse(gTxDevice.m_Properties.AnalogSettings[6].Reverse);      
+    }
+
+    // TX voltage: 0-15V in 1023 steps, level is in 0.1V per cell
+    if (patched(aOffset, aLength, T5X_DEVICE_FIELD(TelemetrySettings.V_TX)))
+    {
+      uint8_t* vTX = gTxDevice.m_Properties.TelemetrySettings.V_TX;
+      g_TxVoltageAlarm.setThresholds(rawThreshold((uint32_t)vTX[T5X_CELLCOUNT]*vTX[T5X_ORANGE]*1023, 150),
+                                     rawThreshold((uint32_t)vTX[T5X_CELLCOUNT]*vTX[T5X_RED]*1023, 150),
+                                     T5X_TX_VOLT_HYSTERESIS);
+    }
+    // RSSI: percent of 255
+    if (patched(aOffset, aLength, T5X_DEVICE_FIELD(TelemetrySettings.RSSIPercent)))
+    {
+      uint8_t* rssi = gTxDevice.m_Properties.TelemetrySettings.RSSIPercent;
+      g_RSSIAlarm.setThresholds(rssi[T5X_ORANGE-1]*255/100, rssi[T5X_RED-1]*255/100, T5X_TELEMETRY_HYSTERESIS);
+    }
 }
 
 
-void applyProfile()
+void applyDeviceSettings()
 {
-    int8_t j=getChannelPosition('A'); if (j>-1) g_channels[j].setSource(rc::Output_AIL1);
-           j=getChannelPosition('E'); if (j>-1) g_channels[j].setSource(rc::Output_ELE1);
-           j=getChannelPosition('T'); if (j>-1) g_channels[j].setSource(rc::Output_THR1);
-           j=getChannelPosition('R'); if (j>-1) g_channels[j].setSource(rc::Output_RUD1);
-           j=getChannelPosition('1'); if (j>-1) g_channels[j].setSource(rc::Output_AUX1);
-           j=getChannelPosition('2'); if (j>-1) g_channels[j].setSource(rc::Output_AUX2);
-           j=getChannelPosition('3'); if (j>-1) g_channels[j].setSource(rc::Output_AUX3);
-           j=getChannelPosition('P'); if (j>-1) g_channels[j].setSource(rc::Output_AUX4);
+    applyDeviceSettings(0, sizeof(gTxDevice.m_Properties));
+}
 
-    // initialize expo and dualrate objects with the profile specific values
+
+void beepTelemetryAlarm(const t5x::Alarm& aAlarm)
+{
+    if (aAlarm.level()==t5x::Alarm::Level_Red) rc::g_Buzzer.beep(10,10,2);
+    else if (aAlarm.level()==t5x::Alarm::Level_Orange) rc::g_Buzzer.beep(20);
+}
+
+
+// applies the part of the profile that changed, so a single expo value only recompiles one response table
+void applyProfile(uint8_t aOffset, uint8_t aLength)
+{
+    if (patched(aOffset, aLength, T5X_PROFILE_FIELD(ChannelOrder)) || patched(aOffset, aLength, T5X_PROFILE_FIELD(ChannelCount)))
+    {
+      compileChannelPlan(gProfile.m_Data, gChannelPlan);
+      applyChannelPlan();
+    }
+
+    // compile the profile specific expo and dualrate values of each flight mode into the response tables
     for (uint8_t i=0; i < 6; i++)
     {
-        g_ailExpo[i].set(gProfile.m_Data.AilExpo[i]);
-        g_eleExpo[i].set(gProfile.m_Data.EleExpo[i]);
-        g_rudExpo[i].set(gProfile.m_Data.RudExpo[i]);
-          g_ailDR[i].set(gProfile.m_Data.AilDR[i]  );
-          g_eleDR[i].set(gProfile.m_Data.EleDR[i]  );
-          g_rudDR[i].set(gProfile.m_Data.RudDR[i]  );
+        if (patched(aOffset, aLength, offsetof(t5x::Profile_t, AilExpo)+i, 1) || patched(aOffset, aLength, offsetof(t5x::Profile_t, AilDR)+i, 1))
+          g_ailResponse[i].compile(rc::Expo(gProfile.m_Data.AilExpo[i]), rc::DualRates(gProfile.m_Data.AilDR[i]));
+        if (patched(aOffset, aLength, offsetof(t5x::Profile_t, EleExpo)+i, 1) || patched(aOffset, aLength, offsetof(t5x::Profile_t, EleDR)+i, 1))
+          g_eleResponse[i].compile(rc::Expo(gProfile.m_Data.EleExpo[i]), rc::DualRates(gProfile.m_Data.EleDR[i]));
+        if (patched(aOffset, aLength, offsetof(t5x::Profile_t, RudExpo)+i, 1) || patched(aOffset, aLength, offsetof(t5x::Profile_t, RudDR)+i, 1))
+          g_rudResponse[i].compile(rc::Expo(gProfile.m_Data.RudExpo[i]), rc::DualRates(gProfile.m_Data.RudDR[i]));
     }
     
-    // fill channel values buffer with same values, all centered
-    j=getChannelPosition('A'); if (j>-1) rc::setOutputChannel(rc::OutputChannel(j), rc::normalizedToMicros(0));
-    j=getChannelPosition('E'); if (j>-1) rc::setOutputChannel(rc::OutputChannel(j), rc::normalizedToMicros(0));
-    j=getChannelPosition('T'); if (j>-1) rc::setOutputChannel(rc::OutputChannel(j), rc::normalizedToMicros(-256));
-    j=getChannelPosition('R'); if (j>-1) rc::setOutputChannel(rc::OutputChannel(j), rc::normalizedToMicros(0));
-    j=getChannelPosition('1'); if (j>-1) rc::setOutputChannel(rc::OutputChannel(j), rc::normalizedToMicros(0));
-    j=getChannelPosition('2'); if (j>-1) rc::setOutputChannel(rc::OutputChannel(j), rc::normalizedToMicros(0));
-    j=getChannelPosition('3'); if (j>-1) rc::setOutputChannel(rc::OutputChannel(j), rc::normalizedToMicros(0));
-    j=getChannelPosition('P'); if (j>-1) rc::setOutputChannel(rc::OutputChannel(j), rc::normalizedToMicros(0));
-    j=getChannelPosition('M'); if (j>-1) rc::setOutputChannel(rc::OutputChannel(j), rc::normalizedToMicros(0));
-    j=getChannelPosition('-'); if (j>-1) rc::setOutputChannel(rc::OutputChannel(j), rc::normalizedToMicros(0));        
-    
-    gTimer.setTarget(gProfile.m_Data.Timer);
-    gTimer.setDirection(false);                     // count down timer
-  
+    // A1: 0-13,2V in 255 steps, level is in 0.1V per cell
+    if (patched(aOffset, aLength, T5X_PROFILE_FIELD(V_A1)))
+    {
+      uint8_t* vA1 = gProfile.m_Data.V_A1;
+      g_A1Alarm.setThresholds(rawThreshold((uint32_t)vA1[T5X_CELLCOUNT]*vA1[T5X_ORANGE]*255, 132),
+                              rawThreshold((uint32_t)vA1[T5X_CELLCOUNT]*vA1[T5X_RED]*255, 132),
+                              T5X_TELEMETRY_HYSTERESIS);
+    }
+    // A2: 0-3,3V in 255 steps times the voltage divider ratio (high nibble), cell count in the low nibble
+    if (patched(aOffset, aLength, T5X_PROFILE_FIELD(V_A2)))
+    {
+      uint8_t* vA2 = gProfile.m_Data.V_A2;
+      uint8_t  a2Ratio = (vA2[T5X_CELLCOUNT] & 0xF0) >> 4;
+      uint8_t  a2Cells =  vA2[T5X_CELLCOUNT] & 0x0F;
+      g_A2Alarm.setThresholds(rawThreshold((uint32_t)a2Cells*vA2[T5X_ORANGE]*255, 33*a2Ratio),
+                              rawThreshold((uint32_t)a2Cells*vA2[T5X_RED]*255, 33*a2Ratio),
+                              T5X_TELEMETRY_HYSTERESIS);
+    }
+
+    if (patched(aOffset, aLength, T5X_PROFILE_FIELD(Timer)))
+    {
+      gTimer.setTarget(gProfile.m_Data.Timer);
+      gTimer.setDirection(false);                   // count down timer
+    }
+}
+
+
+void applyProfile()
+{
+    applyProfile(0, sizeof(gProfile.m_Data));
+}
+
+
+// compiles the response tables of one flight mode from gProfile
+void compileResponse(uint8_t aFlightMode)
+{
+    g_ailResponse[aFlightMode].compile(rc::Expo(gProfile.m_Data.AilExpo[aFlightMode]), rc::DualRates(gProfile.m_Data.AilDR[aFlightMode]));
+    g_eleResponse[aFlightMode].compile(rc::Expo(gProfile.m_Data.EleExpo[aFlightMode]), rc::DualRates(gProfile.m_Data.EleDR[aFlightMode]));
+    g_rudResponse[aFlightMode].compile(rc::Expo(gProfile.m_Data.RudExpo[aFlightMode]), rc::DualRates(gProfile.m_Data.RudDR[aFlightMode]));
+    gResponseStale &= ~(1 << aFlightMode);
 }
 
+// cooperative tasks, the order in gTasks is their priority
+void taskSticks();
+void taskProfileSwitch();
+void taskBoot();
+void taskTelemetry();
+void taskConfigurator();
+void taskFlightTimer();
+void taskRealtimeData();
+#ifdef T5X_STAGE_TIMING
+void taskStageTiming();
+#endif
+
+enum
+{
+  Task_Sticks,
+  Task_ProfileSwitch,
+  Task_Boot,
+  Task_Telemetry,
+  Task_Configurator,
+  Task_FlightTimer,
+  Task_RealtimeData,
+#ifdef T5X_STAGE_TIMING
+  Task_StageTiming,
+#endif
+  TaskCount
+};
+
+const t5x::Task_t gTasks[TaskCount] =
+{
+  //Function          Period  Deadline (ms)
+  { taskSticks,            0,    0},   // every frame
+  { taskProfileSwitch,     0,    0},   // every frame, right after the sticks so a switch lands between two frames
+  { taskBoot,             50,  100},   // until the startup beeps are done
+  { taskTelemetry,        20,   40},   // 64 byte serial buffer fills in ~66ms at 9600 baud
+  { taskConfigurator,     20,   40},
+  { taskFlightTimer,    1000,  100},
+  { taskRealtimeData,      0,    0},   // every frame, paced by gRealtimeInterval
+#ifdef T5X_STAGE_TIMING
+  { taskStageTiming,     250,  250},
+#endif
+};
+
+t5x::Scheduler          gScheduler(gTasks, TaskCount);
+
+
+enum BootState_t
+{
+  Boot_Welcome,       // welcome beep started by setup()
+  Boot_ProfileId,     // beeping the profile id
+  Boot_Done
+};
+BootState_t             gBootState      = Boot_Welcome;
+unsigned long           gBootStateSince = 0;
+
+
+enum ProfileSwitch_t
+{
+  ProfileSwitch_Idle,
+  ProfileSwitch_Load,     // read the record into gProfileStaging
+  ProfileSwitch_Plan,     // compile its channel plan into gChannelPlanStaging
+  ProfileSwitch_Apply,    // make both active, along with the response tables of the current flight mode
+  ProfileSwitch_Compile   // compile the response tables of the other flight modes, one per pass
+};
+ProfileSwitch_t         gProfileSwitch         = ProfileSwitch_Idle;
+uint8_t                 gProfileRequest        = 0;
+unsigned long           gProfileRequestTime    = 0;
+#ifdef T5X_PROFILE_SWITCH_HOLD
+uint8_t                 gProfileCandidate      = 0;    // profile selected by the switches
+unsigned long           gProfileCandidateSince = 0;
+#endif
+
+
+// profile selected by the positions of SW2 and SW3
+uint8_t selectedProfileId()
+{
+        uint8_t port = g_SwitchBank.getState();
+        if (gTxDevice.m_Properties.Sw2IsPrimaryProfileSelector) 
+          return (2-g_SW2.read(port))+((2-g_SW3.read(port))*3);
+        else
+          return (2-g_SW3.read(port))+((2-g_SW2.read(port))*3);
+}
+
+
+// throttle position in percent, 0 is idle
+int16_t throttlePercent()
+{
+        return 50*(gThrottle_us-T5X_PPM_CENTER-T5X_PPM_TRAVEL)/T5X_PPM_TRAVEL+100;
+}
+
+
+// switches to another profile at runtime, a request made while a switch is underway restarts it
+void requestProfile(uint8_t aProfileId)
+{
+        if (aProfileId > 8) return;
+        gProfileRequest     = aProfileId;
+        gProfileRequestTime = millis();
+        gProfileSwitch      = ProfileSwitch_Load;
+}
+
+
 void setup()
 {
   	// Initialize timer
 	rc::Timer1::init();
 	rc::Timer2::init();
 
-        Serial.begin(9600);    // telemetry/configuration
+        Serial.begin(T5X_SERIAL_BAUD);    // telemetry/configuration
 
-#ifdef T5X_CONDITIONAL_INITIALIZE_EEPROM        
-        if (t5x::EEPROMVersionIsInvalid())
-        {
-          gTxDevice.init();
-          gProfile.init();
-          t5x::SetValidEEPROMVersion();
-        }
+#ifdef T5X_USE_EEPROM
+        t5x::migrateLegacyEEPROM(gTxDevice, gProfile);   // once, for EEPROM written by firmware without records
 #endif        
 
         gTxDevice.load();      // load device settings either from EEPROM or ROM, depending on, if T5X_USE_EEPROM is defined
@@ -247,19 +509,24 @@ void setup()
         else 
           g_OperatingMode=OperatingMode_Normal;
 
-         
-        if (gTxDevice.m_Properties.Sw2IsPrimaryProfileSelector) 
-          gRealtime.m_Data.ProfileId=(2-g_SW2.read())+((2-g_SW3.read())*3);
-        else
-          gRealtime.m_Data.ProfileId=(2-g_SW3.read())+((2-g_SW2.read())*3);
+        t5x::gProtocol.setFramedOnly(g_OperatingMode==OperatingMode_Normal);   // telemetry data could look like v1 messages
+
+        g_SwitchBank.reset();  // start from the switch positions at power on, without waiting for the debounce
 
+        rc::ADCSampler::start(T5X_ADC_OVERSAMPLING);   // from now on analog inputs are read from the background sampler
+
+         
+        gRealtime.m_Data.ProfileId=selectedProfileId();
+#ifdef T5X_PROFILE_SWITCH_HOLD
+        gProfileCandidate=gRealtime.m_Data.ProfileId;
+#endif
 
         gProfile.load(gRealtime.m_Data.ProfileId);
         applyProfile();
          
 	
          // read switch to enable/disable buzzer (silence mode)
-  	rc::SwitchState tSwitchState = g_SW1.read();
+  	rc::SwitchState tSwitchState = g_SW1.read(g_SwitchBank.getState());
         if ((tSwitchState == rc::SwitchState_Up) and (g_OperatingMode==OperatingMode_Normal))   
         {
           rc::g_Buzzer.setPin(T5X_TX_BUZZER_PIN);  // buzzer on -  NORMAL MODE
@@ -279,23 +546,44 @@ void setup()
 	// set up PPM
 	g_PPMOut.setPulseLength(400);   // default pulse length used by FrSky hardware
 	g_PPMOut.setPauseLength(20000); // default frame length used by FrSky hardware
+#ifdef T5X_PPM_SYNC_LENGTH
+	g_PPMOut.setAdaptiveFrame(T5X_PPM_SYNC_LENGTH, T5X_PPM_FRAME_MIN); // frame only as long as the channels need
+#endif
+#ifdef T5X_FRAME_SYNC_LEAD
+	g_PPMOut.setSyncLead(T5X_FRAME_SYNC_LEAD); // get notified in time to deliver fresh values for each frame
+#endif
 	g_PPMOut.start(9); // use pin 9, which is preferred as it's faster
 
-        delay(1500);
-        rc::g_Buzzer.beep(20, 10, gRealtime.m_Data.ProfileId);      // beep gRealtime.m_Data.ProfileId times
-        delay(3000);
-
-        if (g_OperatingMode==OperatingMode_Setup)
-          rc::g_Buzzer.beep(5, 2, 20);                    // signal that we are in setup mode        
+        // the remaining startup beeps are played by taskBoot, loop() and live sticks start right away
+        gBootStateSince = millis();
+
+        gScheduler.enable(Task_Sticks, true);
+        gScheduler.enable(Task_ProfileSwitch, true);
+        gScheduler.enable(Task_Boot, true);
+        gScheduler.enable(Task_FlightTimer, true);
+        gScheduler.enable(Task_Configurator, g_OperatingMode==OperatingMode_Setup);
+#ifdef T5X_MUX_SLICE_US
+        gScheduler.enable(Task_RealtimeData, true);     // only streams in normal mode once the configurator subscribes
+#else
+        gScheduler.enable(Task_RealtimeData, g_OperatingMode==OperatingMode_Setup);
+#endif
+#ifdef T5X_STAGE_TIMING
+        gScheduler.enable(Task_StageTiming,  g_OperatingMode==OperatingMode_Setup);
+#endif
 }
 
-void loop()
+// read sticks and switches, mix and hand the channels to PPMOut. runs on every frame
+void taskSticks()
 {
-        int16_t throttle_val=0;
-        
-	gRealtime.m_Data.SwitchState[0] = g_SW1.read();
-	gRealtime.m_Data.SwitchState[1] = g_SW2.read();
-	gRealtime.m_Data.SwitchState[2] = g_SW3.read();
+      // switch states, flight mode and the analog switches only change when a debounced pin changed
+      if (g_SwitchBank.update() || gSwitchesStale)
+      {
+        T5X_STAGE(Stage_Switches);
+        gSwitchesStale = false;
+        uint8_t port = g_SwitchBank.getState();
+	gRealtime.m_Data.SwitchState[0] = g_SW1.read(port);
+	gRealtime.m_Data.SwitchState[1] = g_SW2.read(port);
+	gRealtime.m_Data.SwitchState[2] = g_SW3.read(port);
 
         rc::SwitchState fSwitchState = rc::SwitchState_Disconnected;
         if (gTxDevice.m_Properties.Sw2SelectsFlightMode) 
@@ -308,28 +596,32 @@ void loop()
         else if (fSwitchState == rc::SwitchState_Center) gRealtime.m_Data.FlightMode = 1;
         else if (fSwitchState == rc::SwitchState_Up    ) gRealtime.m_Data.FlightMode = 2;
 
-        if ((gRealtime.m_Data.SwitchState[0]==rc::SwitchState_Up) && (strchr(gProfile.m_Data.ChannelOrder,'M')!=NULL)) gRealtime.m_Data.FlightMode=gRealtime.m_Data.FlightMode+3;  // virtual flightmode active? if so, evaluate switch 2 for that purpose
+        if ((gRealtime.m_Data.SwitchState[0]==rc::SwitchState_Up) && gChannelPlan.VirtualFlightMode) gRealtime.m_Data.FlightMode=gRealtime.m_Data.FlightMode+3;  // virtual flightmode active? if so, evaluate switch 2 for that purpose
   
-	g_AnalogSW1.update();  // update the input system
+	g_AnalogSW1.update();  // update the input system, they switch instantly so they don't need updates in between
 	g_AnalogSW2.update();  // update the input system
 	g_AnalogSW3.update();  // update the input system
-
+      }
 	
+      {
+        T5X_STAGE(Stage_ADC);
 	// read analog values, these write to the input system (AIL, ELE, THR, RUD & POT1)
         for (int i=0; i<4; i++) g_aPins[i].read(); 
        
         g_Pot1.read();
-
+      }
         
-	// apply expo and dual rates to input, these read from and write to input system
-	g_ailExpo[gRealtime.m_Data.FlightMode].apply();
-	g_eleExpo[gRealtime.m_Data.FlightMode].apply();
-	g_rudExpo[gRealtime.m_Data.FlightMode].apply();
-
-	g_rudDR[gRealtime.m_Data.FlightMode].apply();
-	g_eleDR[gRealtime.m_Data.FlightMode].apply();
-	g_ailDR[gRealtime.m_Data.FlightMode].apply();
+      {
+        T5X_STAGE(Stage_ExpoDR);
+	// apply expo and dual rates of the flight mode to input, these read from and write to input system
+        if (gResponseStale & (1 << gRealtime.m_Data.FlightMode)) compileResponse(gRealtime.m_Data.FlightMode);   // a profile switch hasn't got to it yet
+	g_ailResponse[gRealtime.m_Data.FlightMode].apply();
+	g_eleResponse[gRealtime.m_Data.FlightMode].apply();
+	g_rudResponse[gRealtime.m_Data.FlightMode].apply();
+      }
 
+      {
+        T5X_STAGE(Stage_Pipes);
         g_aileron.apply();
         g_elevator.apply();
 	g_throttle.apply();
@@ -339,167 +631,502 @@ void loop()
 	g_aux3.apply();        // SW3
         g_aux4.apply();        // Poti
 
+	// apply virtual mode switch value according to flight mode 
+        rc::setOutput(rc::Output_VFM, gTxDevice.m_Properties.VFMSteps[gRealtime.m_Data.FlightMode]);
+      }
+
+      {
+        T5X_STAGE(Stage_Channels);
 	// perform channel transformations and set channel values
-	for (uint8_t i = 0; i < ChannelCount; ++i)
-        {
-          switch (gProfile.m_Data.ChannelOrder[i])
-          {          
-            case '-':   gRealtime.m_Data.Channel_us[i]=g_channels[i].apply(0);                                                            break;   // ensure empty channel remains 0.
-            case 'M':   gRealtime.m_Data.Channel_us[i]=g_channels[i].apply(gTxDevice.m_Properties.VFMSteps[gRealtime.m_Data.FlightMode]); break;   // apply virtual mode switch value according to flight mode 
-            case 'T':   gRealtime.m_Data.Channel_us[i]=g_channels[i].apply(); throttle_val = gRealtime.m_Data.Channel_us[i];              break;
-            default:    gRealtime.m_Data.Channel_us[i]=g_channels[i].apply();                                                                      // apply value from InputToOutputPipe
-          }
-        }
+	for (uint8_t i = 0; i < gChannelPlan.ChannelCount; ++i) gRealtime.m_Data.Channel_us[i]=g_channels[i].apply();
+        gThrottle_us = gChannelPlan.ThrottleChannel>-1 ? gRealtime.m_Data.Channel_us[gChannelPlan.ThrottleChannel] : 0;
+      }
 
+      {
+        T5X_STAGE(Stage_PPMOut);
 	// Tell PPMOut that new values are ready
 	g_PPMOut.update();
-        
-        last=now;
-        now = millis(); 
+      }
+      if (gRealtime.m_Data.BootTime==0) gRealtime.m_Data.BootTime=millis();
+}
 
-   if (g_OperatingMode==OperatingMode_Normal)
-   {
-        g_Frsky.update();    // read telemetry data from serial link and update the values
 
-        if ((now - last_telemetry >= gTxDevice.m_Properties.TelemetrySettings.Check_Interval*1000)) 
+// loads a requested profile and applies it, one step per frame.
+// the record is read from EEPROM and its channel plan compiled in the frame gaps before the switch,
+// which then takes the profile, the plan and the response tables of the current flight mode in one go.
+// the tables of the other flight modes follow one per frame, or right away when the sticks need them,
+// so the sticks of a frame are always processed with a single complete profile.
+void taskProfileSwitch()
+{
+        switch (gProfileSwitch)
         {
-          last_telemetry = now;
-          float voltageTX = analogRead(T5X_TX_VOLT_PIN)*0.0146627565982405; // 0-15V in 1023 steps or 0,0146V per step
-          if (voltageTX < gTxDevice.m_Properties.TelemetrySettings.V_TX[T5X_CELLCOUNT]*gTxDevice.m_Properties.TelemetrySettings.V_TX[T5X_RED]/10.0) rc::g_Buzzer.beep(5,5,2);
-          else if (voltageTX < gTxDevice.m_Properties.TelemetrySettings.V_TX[T5X_CELLCOUNT]*gTxDevice.m_Properties.TelemetrySettings.V_TX[T5X_ORANGE]/10.0) rc::g_Buzzer.beep(50);
+          case ProfileSwitch_Load:
+            gProfileStaging.load(gProfileRequest);
+            gProfileSwitch = ProfileSwitch_Plan;
+            break;
+
+          case ProfileSwitch_Plan:
+            compileChannelPlan(gProfileStaging.m_Data, gChannelPlanStaging);
+            gProfileSwitch = ProfileSwitch_Apply;
+            break;
+
+          case ProfileSwitch_Apply:
+            t5x::EEPROMQueue::flush();                      // a pending save may still read gProfile
+            gProfile.m_Data = gProfileStaging.m_Data;
+            gRealtime.m_Data.ProfileId = gProfileRequest;
+            gChannelPlan = gChannelPlanStaging;
+            applyChannelPlan();
+            applyProfile(T5X_PROFILE_FIELD(V_A1));
+            applyProfile(T5X_PROFILE_FIELD(V_A2));
+            applyProfile(T5X_PROFILE_FIELD(Timer));
+            gResponseStale = 0x3F;
+            compileResponse(gRealtime.m_Data.FlightMode);
+            gRealtime.m_Data.ProfileSwitchTime = millis() - gProfileRequestTime;
+            rc::g_Buzzer.beep(20, 10, gProfileRequest);    // beep the new profile id
+            gProfileSwitch = ProfileSwitch_Compile;
+            break;
+
+          case ProfileSwitch_Compile:
+            for (uint8_t i=0; i < 6; i++)
+            {
+              if (!(gResponseStale & (1 << i))) continue;
+              compileResponse(i);
+              return;
+            }
+            gProfileSwitch = ProfileSwitch_Idle;
+            break;
+
+          default:
+#ifdef T5X_PROFILE_SWITCH_HOLD
+            // follow the switches in normal mode, but only on the ground and once they have settled
+            if (g_OperatingMode==OperatingMode_Normal)
+            {
+              uint8_t id = selectedProfileId();
+              if (id != gProfileCandidate)
+              {
+                gProfileCandidate = id;
+                gProfileCandidateSince = now;
+              }
+              else if (id != gRealtime.m_Data.ProfileId && now - gProfileCandidateSince >= T5X_PROFILE_SWITCH_HOLD
+                       && throttlePercent() <= gTxDevice.m_Properties.FlightTimeTrigger_ThrottlePercent)
+                requestProfile(id);
+            }
+#endif
+            break;
+        }
+}
 
-          if (g_Frsky.TelemetryLinkAlive())
-          {
-            if (g_Frsky.m_A1_Voltage*0.0517647058823529 < gProfile.m_Data.V_A1[T5X_CELLCOUNT]*gProfile.m_Data.V_A1[T5X_RED]/10.0) rc::g_Buzzer.beep(10,10,2);     //  0-13,2V in 255 steps or 0,052V per step
-            else if (g_Frsky.m_A1_Voltage*0.0517647058823529 < gProfile.m_Data.V_A1[T5X_CELLCOUNT]*gProfile.m_Data.V_A1[T5X_ORANGE]/10.0) rc::g_Buzzer.beep(20);  //  0-13,2V in 255 steps or 0,052V per step
 
-            if (g_Frsky.m_A2_Voltage*0.0129411764706*((gProfile.m_Data.V_A2[T5X_CELLCOUNT] & 0xF0) >> 4) < (gProfile.m_Data.V_A2[T5X_CELLCOUNT] & 0x0F)*gProfile.m_Data.V_A2[T5X_RED]/10.0) rc::g_Buzzer.beep(10,10,2);      //  0-3,3V in 255 steps or 0,013V per step, the real voltage range is actually defined by the voltage divider ratio 
-            else if (g_Frsky.m_A2_Voltage*0.0129411764706*((gProfile.m_Data.V_A2[T5X_CELLCOUNT] & 0xF0) >> 4) < (gProfile.m_Data.V_A2[T5X_CELLCOUNT] & 0x0F)*gProfile.m_Data.V_A2[T5X_ORANGE]/10.0) rc::g_Buzzer.beep(20);   //  0-3,3V in 255 steps or 0.013V per step, the real voltage range is actually defined by the voltage divider ratio 
+// plays the startup beeps one after the other, then enables the alarms in normal mode
+void taskBoot()
+{
+        switch (gBootState)
+        {
+          case Boot_Welcome:
+            if (now - gBootStateSince < 1500) return;
+            rc::g_Buzzer.beep(20, 10, gRealtime.m_Data.ProfileId);      // beep gRealtime.m_Data.ProfileId times
+            break;
+
+          case Boot_ProfileId:
+            if (now - gBootStateSince < 3000) return;
+            if (g_OperatingMode==OperatingMode_Setup)
+              rc::g_Buzzer.beep(5, 2, 20);                    // signal that we are in setup mode        
+            gScheduler.enable(Task_Telemetry, g_OperatingMode==OperatingMode_Normal);   // no alarm beeps on top of the startup beeps
+            gScheduler.enable(Task_Boot, false);
+            break;
+
+          default:
+            return;
+        }
+        gBootState = BootState_t(gBootState+1);
+        gBootStateSince = now;
+}
+
+
+// read telemetry and check alarms, normal mode only
+#ifdef T5X_MUX_SLICE_US
+void handleMessage();
+
+// hands every byte from the serial link to the telemetry decoder and to the configurator protocol.
+// bytes are read for at most T5X_MUX_SLICE_US, the rest waits for the next run. a complete configurator message
+// ends the slice, it is dropped if its answer would have to wait for the serial port, the configurator sends it again.
+// returns true if a new telemetry link frame was decoded.
+boolean multiplexSerial()
+{
+        boolean       linkFrame = false;
+        unsigned long start     = micros();
+        while (Serial.available() && micros() - start < T5X_MUX_SLICE_US)
+        {
+          uint8_t b = Serial.read();
+          linkFrame |= g_Frsky.decode(b);
+          if (!t5x::gProtocol.parse(b)) continue;
+          
+          g_Frsky.resync();               // the message may have looked like the start of a telemetry frame
+          if (t5x::gProtocol.writable() >= T5X_PROTOCOL_REPLY_SIZE) handleMessage();
+          break;
+        }
+        return linkFrame;
+}
+#endif
+
 
-            if (g_Frsky.m_RSSI < gTxDevice.m_Properties.TelemetrySettings.RSSIPercent[T5X_RED]*255/100) rc::g_Buzzer.beep(10,10,2);
-            else if (g_Frsky.m_RSSI < gTxDevice.m_Properties.TelemetrySettings.RSSIPercent[T5X_ORANGE]*255/100) rc::g_Buzzer.beep(20);
+void taskTelemetry()
+{
+        boolean worse = g_TxVoltageAlarm.update(rc::ADCSampler::read(T5X_TX_VOLT_PIN));
+
+        boolean linkFrame;
+        {
+          T5X_STAGE(Stage_Frsky);
+#ifdef T5X_MUX_SLICE_US
+          linkFrame = multiplexSerial();
+#else
+          linkFrame = g_Frsky.update();    // read telemetry data from serial link, true if a new link frame was decoded
+#endif
+        }
+        if (linkFrame)
+        {
+          worse |= g_A1Alarm.update(g_Frsky.m_Telemetry.A1_Voltage);
+          worse |= g_A2Alarm.update(g_Frsky.m_Telemetry.A2_Voltage);
+          worse |= g_RSSIAlarm.update(g_Frsky.m_Telemetry.RSSI_Rx);
+        }
+        boolean linkAlive = g_Frsky.TelemetryLinkAlive();
+        if (gTelemetryLinkAlive && !linkAlive) worse = true;
+        gTelemetryLinkAlive = linkAlive;
+
+        // sound an alarm as soon as it gets worse, and repeat it every check interval while it lasts
+        if (worse || (now - last_telemetry >= gTxDevice.m_Properties.TelemetrySettings.Check_Interval*1000UL)) 
+        {
+          last_telemetry = now;
+          if (g_TxVoltageAlarm.level()==t5x::Alarm::Level_Red) rc::g_Buzzer.beep(5,5,2);
+          else if (g_TxVoltageAlarm.level()==t5x::Alarm::Level_Orange) rc::g_Buzzer.beep(50);
+
+          if (linkAlive)
+          {
+            beepTelemetryAlarm(g_A1Alarm);
+            beepTelemetryAlarm(g_A2Alarm);
+            beepTelemetryAlarm(g_RSSIAlarm);
           }
           else  rc::g_Buzzer.beep(10,10,2);
         }
+}
 
-   }
-   else // g_OperatingMode==OperatingMode_Setup
-   {
 
-     while (Serial.available()) 
-     {
-        byte b = Serial.read();  
-              
-        if      ( (byteCount==0) && (b==0xFE))   gRxBuffer[byteCount++]=b;  // first header byte 
-        else if ( (byteCount==1) && (b==0xFE))   gRxBuffer[byteCount++]=b;  // 2nd header byte
-        else if (  byteCount==2)
+// tell the configurator that the EEPROM is up to date
+void sendSaveReport()
+{
+    uint16_t report[2] = {t5x::EEPROMQueue::getWritten(), t5x::EEPROMQueue::getSkipped()};
+    t5x::gProtocol.send(T5X_MSG_SAVE_CONFIG_DONE_INFO_MSGID, report, sizeof(report));
+}
+
+
+// true if the UART gets within T5X_SERIAL_MAX_BAUD_ERROR of aBaud, with the double speed divider HardwareSerial uses
+boolean baudSupported(uint32_t aBaud)
+{
+        if (aBaud < T5X_SERIAL_BAUD || aBaud > T5X_SERIAL_MAX_BAUD) return false;
+        uint32_t actual = F_CPU/8/((F_CPU/4/aBaud-1)/2+1);
+        uint32_t error  = actual > aBaud ? actual-aBaud : aBaud-actual;
+        return error*1000 <= aBaud*T5X_SERIAL_MAX_BAUD_ERROR;
+}
+
+
+// answers a baud rate request at the current rate, the switch happens with the next run of taskConfigurator
+void requestBaud(uint32_t aBaud)
+{
+        if (aBaud != gLinkBaud && !baudSupported(aBaud)) aBaud = 0;
+
+        // the receive buffer is a ring that keeps one slot free, so it holds one byte less than its size
+#ifdef SERIAL_RX_BUFFER_SIZE
+        BaudRateInfo_t info = {aBaud, (uint8_t)(SERIAL_RX_BUFFER_SIZE - 1), (uint8_t)gTasks[Task_Configurator].Period};
+#else
+        BaudRateInfo_t info = {aBaud, 63, (uint8_t)gTasks[Task_Configurator].Period};
+#endif
+        t5x::gProtocol.send(T5X_MSG_BAUD_RATE_INFO_MSGID, &info, sizeof(info));
+
+        if (aBaud == 0 || aBaud == gLinkBaud) return;  // refused, or just a keep alive
+        gLinkBaud  = aBaud;
+        gLinkState = Link_Switching;
+}
+
+
+// goes back to T5X_SERIAL_BAUD when the configurator is gone
+void checkLink()
+{
+        switch (gLinkState)
         {
-          if(
-              (b==T5X_MSG_TXDEVICE_PROPERTIES_REQ_MSGID) 
-              || 
-              (b==T5X_MSG_PROFILE_DATA_REQ_MSGID) 
-              || 
-              (b==T5X_MSG_PROFILE_DATA_APPLY_MSGID)
-              ||
-              (b==T5X_MSG_TXDEVICE_PROPERTIES_APPLY_MSGID)
-              ||
-              (b==T5X_MSG_SAVE_CONFIG_TO_EEPROM_MSGID)
-            )   
-             gRxBuffer[byteCount++]=b;  // valid message ID?
-            else
-              byteCount=0;
+          case Link_Switching:
+            Serial.flush();                  // the answer had a whole task period to go out, usually returns at once
+            Serial.begin(gLinkBaud);
+            gLinkState = Link_Confirming;
+            gLinkSince = now;
+            break;
+
+          case Link_Confirming:
+            if (now - gLinkSince < T5X_SERIAL_CONFIRM_TIMEOUT) break;
+            Serial.begin(gLinkBaud = T5X_SERIAL_BAUD);
+            gLinkState = Link_Default;
+            break;
+
+          case Link_Fast:
+            if (now - gLinkSince < T5X_SERIAL_LINK_TIMEOUT) break;
+            Serial.begin(gLinkBaud = T5X_SERIAL_BAUD);
+            gLinkState = Link_Default;
+            break;
+
+          default:
+            break;
         }
-        else if (byteCount>2)
+}
+
+
+// messages that may be handled while flying. they cost at most one response table compile and their
+// answer is a single ACK or NAK, so they never wait for the serial port.
+boolean allowedInNormalMode()
+{
+        const byte* patch = t5x::gProtocol.payload();
+        switch (t5x::gProtocol.msgId())
         {
-          switch (gRxBuffer[2])
-          {
-            case T5X_MSG_TXDEVICE_PROPERTIES_REQ_MSGID:            
+          case T5X_MSG_REALTIME_SUBSCRIBE_MSGID:
+            return true;
+
+          case T5X_MSG_PATCH_APPLY_MSGID:
+            if (t5x::gProtocol.length()<3 || patch[0]!=T5X_PATCH_PROFILE) return false;
+            return (patch[2]==1 && patch[1]<offsetof(t5x::Profile_t, V_A1))     // one expo or dual rate value
+                   || within(patch[1], patch[2], T5X_PROFILE_FIELD(V_A1))
+                   || within(patch[1], patch[2], T5X_PROFILE_FIELD(V_A2))
+                   || within(patch[1], patch[2], T5X_PROFILE_FIELD(Timer));
+        }
+        return false;
+}
+
+
+// handles the message the protocol just received
+void handleMessage()
+{
+        uint8_t msgId = t5x::gProtocol.msgId();
+        gLinkSince = now;
+        if (gLinkState == Link_Confirming) gLinkState = Link_Fast;
+
+        if (g_OperatingMode==OperatingMode_Normal && !allowedInNormalMode())
+        {
+          t5x::gProtocol.nak(T5X_NAK_MODE);
+          return;
+        }
+
+        if (t5x::gProtocol.isRepeat() && msgId!=T5X_MSG_PROFILE_DATA_REQ_MSGID && msgId!=T5X_MSG_TXDEVICE_PROPERTIES_REQ_MSGID
+                                      && msgId!=T5X_MSG_BULK_EXPORT_REQ_MSGID)
+        {
+          t5x::gProtocol.ack();     // done already, only the ACK got lost
+          return;
+        }
 
+        switch (msgId)
+        {
+            case T5X_MSG_TXDEVICE_PROPERTIES_REQ_MSGID:            
+                t5x::gProtocol.ack();
                 gTxDevice.send();
-                byteCount=0;           
                 break;
             
 
             case T5X_MSG_PROFILE_DATA_REQ_MSGID:
-
+                t5x::gProtocol.ack();
                 gProfile.send();
-                byteCount=0;           
                 break;
                 
             case T5X_MSG_PROFILE_DATA_APPLY_MSGID:
-            
-                gRxBuffer[byteCount]=b;
-                
-                if (byteCount<(sizeof(gProfile.m_Data)+2))  
-                {              
-                  byteCount++;
-                }
-                else
+                if (t5x::gProtocol.length()!=sizeof(gProfile.m_Data))
                 {
-                  rc::g_Buzzer.beep(5, 2, 1);              
-                  byteCount=0;
-                  gProfile.receive(gRxBuffer);
-                  applyProfile();    // apply gProfile to actual Tx
+                  t5x::gProtocol.nak(T5X_NAK_LENGTH);
+                  break;
                 }
-                  
+                t5x::gProtocol.ack();
+                rc::g_Buzzer.beep(5, 2, 1);              
+                gProfile.receive(t5x::gProtocol.payload());
+                applyProfile();    // apply gProfile to actual Tx
                 break;
             
             case T5X_MSG_TXDEVICE_PROPERTIES_APPLY_MSGID:
-
-                gRxBuffer[byteCount]=b;
-                
-                if (byteCount<(sizeof(gTxDevice.m_Properties)+2))  
-                {              
-                  byteCount++;
-                }
-                else
+                if (t5x::gProtocol.length()!=sizeof(gTxDevice.m_Properties))
                 {
-                  rc::g_Buzzer.beep(5, 2, 1);              
-                  byteCount=0;
-                  gTxDevice.receive(gRxBuffer);
-                  applyDeviceSettings(); 
+                  t5x::gProtocol.nak(T5X_NAK_LENGTH);
+                  break;
                 }
-                   
+                t5x::gProtocol.ack();
+                rc::g_Buzzer.beep(5, 2, 1);              
+                gTxDevice.receive(t5x::gProtocol.payload());
+                applyDeviceSettings(); 
                 break;
   
              case T5X_MSG_SAVE_CONFIG_TO_EEPROM_MSGID:            
+                t5x::gProtocol.ack();
                 rc::g_Buzzer.beep(3, 2, 10); 
                 gTxDevice.save();
-                gProfile.save(gRealtime.m_Data.ProfileId);               
-                byteCount=0;           
+                gProfile.save(gRealtime.m_Data.ProfileId);     // both are written in the background
+                gSaveReportPending = true;
                 break;
                 
+             case T5X_MSG_PROFILE_SELECT_MSGID:
+                if (t5x::gProtocol.length()!=1)
+                {
+                  t5x::gProtocol.nak(T5X_NAK_LENGTH);
+                  break;
+                }
+                t5x::gProtocol.ack();
+                requestProfile(t5x::gProtocol.payload()[0]);
+                break;
+                
+             case T5X_MSG_PATCH_APPLY_MSGID:
+             {
+                // struct, offset, length, bytes
+                const byte* patch = t5x::gProtocol.payload();
+                boolean     valid = t5x::gProtocol.length()>=3 && patch[2]==t5x::gProtocol.length()-3;
+                if      (valid && patch[0]==T5X_PATCH_PROFILE)  valid = gProfile.patch(patch[1], patch+3, patch[2]);
+                else if (valid && patch[0]==T5X_PATCH_TXDEVICE) valid = gTxDevice.patch(patch[1], patch+3, patch[2]);
+                else valid = false;
+                if (!valid)
+                {
+                  t5x::gProtocol.nak(T5X_NAK_LENGTH);
+                  break;
+                }
+                t5x::gProtocol.ack();
+                if (patch[0]==T5X_PATCH_PROFILE) applyProfile(patch[1], patch[2]);
+                else                             applyDeviceSettings(patch[1], patch[2]);
+                break;
+             }
+
+             case T5X_MSG_REALTIME_SUBSCRIBE_MSGID:
+             {
+                if (t5x::gProtocol.length()!=sizeof(uint16_t)+1)
+                {
+                  t5x::gProtocol.nak(T5X_NAK_LENGTH);
+                  break;
+                }
+                t5x::gProtocol.ack();
+                uint16_t mask;
+                memcpy(&mask, t5x::gProtocol.payload(), sizeof(mask));
+                gRealtime.subscribe(mask);
+                gRealtimeInterval = t5x::gProtocol.payload()[2];
+                break;
+             }
+
+             case T5X_MSG_BULK_EXPORT_REQ_MSGID:
+                t5x::gProtocol.ack();
+                t5x::gBulkTransfer.startExport();     // one record per run of this task, see below
+                break;
+
+             case T5X_MSG_BULK_IMPORT_BEGIN_MSGID:
+                t5x::gProtocol.ack();
+                t5x::gBulkTransfer.startImport();
+                break;
+
+             case T5X_MSG_BULK_RECORD_APPLY_MSGID:
+             {
+                uint8_t reason = t5x::gBulkTransfer.importRecord(t5x::gProtocol.payload(), t5x::gProtocol.length());
+                if (reason) t5x::gProtocol.nak(reason);
+                else        t5x::gProtocol.ack();
+                break;
+             }
+
+             case T5X_MSG_BULK_IMPORT_END_MSGID:
+             {
+                const byte* summary = t5x::gProtocol.payload();
+                if (t5x::gProtocol.length()!=3 || !t5x::gBulkTransfer.endImport(summary[0], summary[1] | (summary[2] << 8)))
+                {
+                  t5x::gProtocol.nak(T5X_NAK_CRC);
+                  break;
+                }
+                t5x::gProtocol.ack();
+                rc::g_Buzzer.beep(3, 2, 10); 
+                gTxDevice.load();                               // run with what was just written
+                applyDeviceSettings();
+                gProfile.load(gRealtime.m_Data.ProfileId);
+                applyProfile();
+                break;
+             }
+
+             case T5X_MSG_BAUD_RATE_REQ_MSGID:
+             {
+                if (t5x::gProtocol.length()!=sizeof(uint32_t))
+                {
+                  t5x::gProtocol.nak(T5X_NAK_LENGTH);
+                  break;
+                }
+                t5x::gProtocol.ack();
+                uint32_t baud;
+                memcpy(&baud, t5x::gProtocol.payload(), sizeof(baud));
+                requestBaud(baud);
+                break;
+             }
+                
             default:
-                byteCount=0;  
-          }  
-        }        
+                t5x::gProtocol.nak(T5X_NAK_UNKNOWN);
+        }  
+}
+
+
+// handle messages from the configurator application, setup mode only
+void taskConfigurator()
+{
+     T5X_STAGE(Stage_Serial);
+
+     checkLink();
+
+     while (Serial.available()) 
+     {
+        if (t5x::gProtocol.parse(Serial.read())) handleMessage();
      }
-    
-      if (now - last_realtime_data > 60)   // we report real time data only every now and then, otherwise we would get misleading looptime values caused only because of serial communication...
-      {
-        last_realtime_data=now;
-        gRealtime.m_Data.Analog[0]=analogRead(A0);
-        gRealtime.m_Data.Analog[1]=analogRead(A1);
-        gRealtime.m_Data.Analog[2]=analogRead(A2);
-        gRealtime.m_Data.Analog[3]=analogRead(A3);
-        gRealtime.m_Data.Analog[4]=analogRead(A4);
-        gRealtime.m_Data.Analog[5]=analogRead(A5);
-        gRealtime.m_Data.Analog[6]=analogRead(A6);
-        gRealtime.m_Data.Analog[7]=analogRead(A7);
+
+     t5x::gBulkTransfer.exportNext();
+
+     if (gSaveReportPending && !t5x::EEPROMQueue::isBusy())
+     {
+        gSaveReportPending = false;
+        sendSaveReport();
+     }
+}
+
+
+// report real time data to the configurator application, setup mode only.
+// all values were sampled already, either in the background or by taskSticks.
+void taskRealtimeData()
+{
+        if (now - gRealtimeSent < gRealtimeInterval) return;
+        gRealtimeSent = now;
+        
+        for (uint8_t i=0; i<8; i++) gRealtime.m_Data.Analog[i]=rc::ADCSampler::read(A0+i);   // latest background conversions, no waiting on the ADC
         
         gRealtime.m_Data.FlightTimerSec=gTimer.getTime();
   
         gRealtime.m_Data.FreeRAM=freeRam();
         gRealtime.m_Data.LoopTime=now-last;
+        gRealtime.m_Data.PPMLatency=g_PPMOut.getLatency();
   
-        gRealtime.send();
-      }
-   }
-   
-    if (now - last_flight_timer >= 1000)
-    {
-      last_flight_timer = now;
-      if ((50*(throttle_val-T5X_PPM_CENTER-T5X_PPM_TRAVEL)/T5X_PPM_TRAVEL+100) > gTxDevice.m_Properties.FlightTimeTrigger_ThrottlePercent)  
+        for (uint8_t i=0; i<TaskCount; i++)
+        {
+          gRealtime.m_Data.TaskWorstCase_us[i]=gScheduler.worstCase(i);
+          gRealtime.m_Data.TaskDeadlineMisses[i]=gScheduler.misses(i);
+        }
+  
+        if (!gRealtime.isSubscribed())
+        {
+          if (g_OperatingMode==OperatingMode_Setup) gRealtime.send();   // configurators that don't know about subscriptions
+        }
+        else gRealtime.sendChanges();   // never waits for the serial port
+}
+
+
+#ifdef T5X_STAGE_TIMING
+// report stage timings to the configurator application, setup mode only
+void taskStageTiming()
+{
+        t5x::gStageTiming.sendNext();
+}
+#endif
+
+
+// count flight time while the throttle is above the trigger, once a second
+void taskFlightTimer()
+{
+      if (throttlePercent() > gTxDevice.m_Properties.FlightTimeTrigger_ThrottlePercent)  
       {
         if (gTimerSecAtPaused==0) gTimer.update(true);
         else
@@ -513,6 +1140,18 @@ void loop()
         gTimer.update(false);
         gTimerSecAtPaused=gTimer.getTime();
     	}
-    }
+}
 
+
+void loop()
+{
+#ifdef T5X_FRAME_SYNC_LEAD
+        if (!g_PPMOut.isFrameReady()) return;   // nothing to do until PPMOut asks for the values of the next frame
+#endif
+
+        last=now;
+        now = millis(); 
+
+        gScheduler.run(now);
 }
+
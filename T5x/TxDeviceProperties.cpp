@@ -1,8 +1,8 @@
 #include "TxDeviceProperties.h"
 #include "config.h"
 #include "util.h"
-
-#define T5X_DEVICE_PROPS_EEPROM_STARTADDR  0
+#include "EEPROMQueue.h"
+#include "Protocol.h"
 
 namespace t5x
 {
@@ -10,7 +10,11 @@ namespace t5x
 void TxDeviceProperties::load()
 {
 #ifdef T5X_USE_EEPROM
-  EEPROM_readAnything(T5X_DEVICE_PROPS_EEPROM_STARTADDR, m_Properties); 
+  EEPROMQueue::flush();   // m_Properties is about to change and may still be queued
+  uint8_t length = 0;
+  if (readRecord(T5X_DEVICE_PROPS_EEPROM_STARTADDR, &m_Properties, sizeof(m_Properties), length) != T5X_DEVICE_PROPS_VERSION
+      || length != sizeof(m_Properties))
+    m_Properties = gDefaultDeviceSettings;
 #else
   m_Properties = gDefaultDeviceSettings;
 #endif
@@ -21,37 +25,36 @@ void TxDeviceProperties::load()
 void TxDeviceProperties::save()
 {
 #ifdef T5X_USE_EEPROM
-  EEPROM_writeAnything(T5X_DEVICE_PROPS_EEPROM_STARTADDR, m_Properties); 
+  writeRecord(T5X_DEVICE_PROPS_EEPROM_STARTADDR, m_Header, T5X_DEVICE_PROPS_VERSION, &m_Properties, sizeof(m_Properties)); 
 #endif  
 }
 
-void TxDeviceProperties::init()
+void TxDeviceProperties::migrateLegacy()
 {
-#ifdef T5X_CONDITIONAL_INITIALIZE_EEPROM
-  EEPROM_writeAnything(T5X_DEVICE_PROPS_EEPROM_STARTADDR, gDefaultDeviceSettings); 
-#endif  
+  EEPROM_readAnything(T5X_DEVICE_PROPS_EEPROM_STARTADDR, m_Properties);   // same layout as version 1
+  save();
+  EEPROMQueue::flush();
 }
 
 
 void TxDeviceProperties::send()
 {
-    Serial.write(T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE1);          // MsgPreamble
-    Serial.write(T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE2);          // MsgPreamble
-    Serial.write(T5X_MSG_TXDEVICE_PROPERTIES_INFO_MSGID);        // MsgId
-
-    char tBuffer[sizeof(m_Properties)];
-    memcpy(tBuffer, &m_Properties,sizeof(m_Properties));
-    
-    for (int i=0;i<sizeof(m_Properties);i++)
-    {
-      Serial.write(tBuffer[i]);
-    }        
+    gProtocol.send(T5X_MSG_TXDEVICE_PROPERTIES_INFO_MSGID, &m_Properties, sizeof(m_Properties));
 }
 
 
-void TxDeviceProperties::receive(byte aMsg[])
+void TxDeviceProperties::receive(const byte aData[])
+{
+  EEPROMQueue::flush();   // m_Properties is about to change and may still be queued
+  memcpy(&m_Properties, aData, sizeof(m_Properties));
+}
+
+boolean TxDeviceProperties::patch(uint8_t aOffset, const byte aData[], uint8_t aLength)
 {
-  memcpy(&m_Properties, aMsg+3,sizeof(m_Properties));
+  if (aOffset > sizeof(m_Properties) || aLength > sizeof(m_Properties) - aOffset) return false;
+  EEPROMQueue::flush();
+  memcpy((uint8_t*)&m_Properties + aOffset, aData, aLength);
+  return true;
 }
 
 } // namespace end
@@ -1,8 +1,9 @@
 #ifndef TXDEVICEPROPERTIES_H
 #define TXDEVICEPROPERTIES_H
 
-#include <arduino.h>
+#include <Arduino.h>
 #include "config.h"
+#include "util.h"
 
 namespace t5x
 {
@@ -48,15 +49,24 @@ class TxDeviceProperties
     T5xDeviceProperties_t m_Properties;
  
     void send();
-    void receive(byte aMsg[]);      // decode the received byte array     
-    void init();                    // initialize Device Properties in EEPROM with default data
-    void load();
+    void receive(const byte aData[]); // take over the payload of a received message
+    boolean patch(uint8_t aOffset, const byte aData[], uint8_t aLength); // overwrite part of m_Properties, false if out of range
+    void load();                    // load from EEPROM, defaults if the record is invalid
     void save();
+    void migrateLegacy();           // convert device properties stored without record header
+
+  private:
+    RecordHeader_t m_Header;        // written along with m_Properties
 };
 
+#define T5X_DEVICE_PROPS_VERSION  1 // layout version of T5xDeviceProperties_t, increase when it changes
+
+#define T5X_DEVICE_PROPS_EEPROM_STARTADDR       0
+#define T5X_DEVICE_PROPS_EEPROM_RESERVED_BYTES  192   // everything up to the profiles
 
 
-#if defined(T5X_CONDITIONAL_INITIALIZE_EEPROM) || not defined(T5X_USE_EEPROM)
+
+// used if there's no valid record
 const t5x::T5xDeviceProperties_t gDefaultDeviceSettings=
 {
   {                                   //    Calibration     ChannelReverse  Comment
@@ -84,7 +94,6 @@ const t5x::T5xDeviceProperties_t gDefaultDeviceSettings=
   false,
   false
 };
-#endif
 
 } // namespace end
 
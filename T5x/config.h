@@ -5,49 +5,128 @@
 // if disabled, data are defined "hardcoded" in Profile.h and TxDeviceProperties.h files
 #define T5X_USE_EEPROM
 
-// if enabled, T5X will check during setup routine, if EEPROM version matches. 
-//             In case it does not, EEPROM gets initialized with defaults
-//             after the initialization of the EEPROM is done, this define can be disabled.
-// if disabled, no check is done. this frees up some ROM and RAM
+// EEPROM holds device properties and profiles as records with length, layout version and CRC,
+// a record that is invalid is replaced by the defaults when it is loaded.
+// if enabled, T5X converts EEPROM contents written by firmware without records once during setup.
+// if disabled, no conversion is done. this frees up some ROM, old contents will be ignored and replaced by defaults.
 #define T5X_CONDITIONAL_INITIALIZE_EEPROM
 
+// if enabled, the EEPROM queue counts the physical writes to every cell, so tests can check that saving unchanged
+//             data causes no wear. needs 2 bytes of RAM per cell, host builds only.
+// if disabled, only the written and skipped bytes of the last batch are counted.
+//#define T5X_EEPROM_WEAR_COUNTERS
+
 
 // this should never be necessary to be changed
 #define T5X_TX_VOLT_PIN    A7        // voltage sensor on A7 
 #define T5X_TX_BUZZER_PIN   8        // buzzer connected to digital pin 8
 #define T5X_TX_LED_PIN     13        // LED is on standard pin 13
 
+// analog inputs are sampled in the background by the ADC interrupt, so reading sticks never waits for a conversion.
+// the value gives the extra bits of resolution gained by oversampling [0-3], every input is converted 4^n times per value
+#define T5X_ADC_OVERSAMPLING 1
+
 // warning levels for Telemetry Stuff
 #define T5X_CELLCOUNT  0
 #define T5X_ORANGE     1
 #define T5X_RED        2
 
+// alarms are checked on every frame, a level change needs this many equal results in a row
+#define T5X_ALARM_DEBOUNCE        3
+// to clear an alarm the value has to rise above the threshold by this many raw steps
+#define T5X_TX_VOLT_HYSTERESIS    7    // ADC steps, about 0.1V
+#define T5X_TELEMETRY_HYSTERESIS  3    // telemetry steps, about 0.15V on A1 or 1% RSSI
+
 
 // our output signal will lie between 800 and 2200 microseconds (1500 +/- 700)
 #define T5X_PPM_CENTER 1500          // servo center point
 #define T5X_PPM_TRAVEL  700          // max servo travel from center point
 
+// if enabled, each PPM frame is only as long as its channels plus the sync gap, but at least the min frame length.
+//             fewer channels in a profile give a higher frame rate. the sync gap is never cut short, 9 or more
+//             channels at full travel make the frame longer than 22.5ms (12 channels up to 30.4ms).
+// if disabled, every frame is 20000 microseconds long.
+#define T5X_PPM_SYNC_LENGTH  4000    // minimum sync gap between frames in microseconds
+#define T5X_PPM_FRAME_MIN   10000    // shortest frame, keeps analog servos behind PPM receivers happy
+
+// if enabled, sticks are read and mixed once per PPM frame, just in time before PPMOut latches the channel values.
+//             this gives a fixed and minimal stick-to-pulse latency. the value is the lead time in microseconds
+//             and has to cover one pass of reading, mixing and channel processing.
+// if disabled, loop() runs free and the latency varies by up to one PPM frame.
+#define T5X_FRAME_SYNC_LEAD 2500
+
+// if enabled, the profile follows SW2/SW3 at runtime in normal mode, as selected at power on. a new position has to be held
+//             for this many milliseconds with the throttle below the flight timer trigger before the profile is switched.
+//             note that SW2 or SW3 also select the flight mode, so changing the flight mode on the ground switches the profile.
+// if disabled, the profile is only selected at power on or by the configurator.
+//#define T5X_PROFILE_SWITCH_HOLD 2000
+
+// if enabled, the configurator can also talk to the TX in normal mode, on the serial link it shares with FrSky telemetry.
+//             each run of the telemetry task reads the link for at most this many microseconds and handles at most one
+//             message. only v2 frames are accepted, and only realtime subscriptions and patches of a single expo, dual rate,
+//             voltage alarm or timer value, so handling a message costs no more than one response table compile.
+// if disabled, the configurator is only served in setup mode.
+#define T5X_MUX_SLICE_US 500
+
+// if enabled, the run time of each stage of the loop (switches, ADC, expo/DR, mixing, ...) is measured with Timer1
+//             and reported to the configurator in setup mode, one stage per message as the serial buffer allows.
+//             costs about 120 bytes of RAM, a debugging aid for firmware development.
+// if disabled, no measurements are taken.
+//#define T5X_STAGE_TIMING
+
 
 //////////////// MESSAGING BETWEEN CONFIGURATOR AND T5X
+#define T5X_SERIAL_BAUD                   9600  // telemetry, and the configurator until it asks for a faster rate
+#define T5X_SERIAL_MAX_BAUD             250000  // fastest rate the configurator may ask for in setup mode
+#define T5X_SERIAL_MAX_BAUD_ERROR           25  // in 1/1000, largest deviation from the asked rate the crystal may cause
+#define T5X_SERIAL_CONFIRM_TIMEOUT         500  // ms for the configurator to send a message at the new rate
+#define T5X_SERIAL_LINK_TIMEOUT           3000  // ms without a message at a fast rate, before going back to T5X_SERIAL_BAUD
+
 // Messages from TX to configurator application
 #define T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE1         0xEF
 #define T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE2         0xEF
+#define T5X_MSG_TX_TO_CONFIGURATOR_FRAMED_PREAMBLE2  0xEE   // v2 frame with sequence number, length and CRC, see Protocol.h
 
-#define T5X_MSG_PROFILE_DATA_INFO_MSGID              0x01   // report profile data to application
+#define T5X_MSG_PROFILE_DATA_INFO_MSGID              0x01   // report profile data to application, Profile_t as of T5X_PROFILE_VERSION.
+                                                            // version 2 added ChannelOrder[13] and ChannelCount, so the payload grew
+                                                            // from 53 to 58 bytes and configurators built for version 1 don't read it
 #define T5X_MSG_REALTIME_DATA_INFO_MSGID             0x02   // report realtime data to application
 #define T5X_MSG_TXDEVICE_PROPERTIES_INFO_MSGID       0x03   // report device properties to application
+#define T5X_MSG_STAGE_TIMING_INFO_MSGID              0x04   // report the loop timings of one stage to application: stage number, then its StageStats_t
+#define T5X_MSG_SAVE_CONFIG_DONE_INFO_MSGID          0x05   // report that saving to EEPROM has finished, with written and skipped byte counts
+#define T5X_MSG_ACK_INFO_MSGID                       0x06   // v2 frame with the sequence number that follows was accepted
+#define T5X_MSG_NAK_INFO_MSGID                       0x07   // v2 frame with the sequence number that follows was rejected, then the reason
+#define T5X_MSG_BAUD_RATE_INFO_MSGID                 0x08   // answer to T5X_MSG_BAUD_RATE_REQ_MSGID, see BaudRateInfo_t
+#define T5X_MSG_REALTIME_DELTA_INFO_MSGID            0x09   // subscribed realtime fields that changed: uint16_t mask of the fields, then the fields
+#define T5X_MSG_BULK_RECORD_INFO_MSGID               0x0A   // one EEPROM record of a bulk export: slot, record header, record data. see BulkTransfer.h
+#define T5X_MSG_BULK_DONE_INFO_MSGID                 0x0B   // end of a bulk export: number of records, uint16_t CRC over their messages
 
 
 
 // Messages from configurator application to TX
 #define T5X_MSG_CONFIGURATOR_TO_TX_PREAMBLE1         0xFE
 #define T5X_MSG_CONFIGURATOR_TO_TX_PREAMBLE2         0xFE
+#define T5X_MSG_CONFIGURATOR_TO_TX_FRAMED_PREAMBLE2  0xFD   // v2 frame with sequence number, length and CRC, see Protocol.h
 
 #define T5X_MSG_PROFILE_DATA_REQ_MSGID               0x41   // application requests profile data from tx
-#define T5X_MSG_PROFILE_DATA_APPLY_MSGID             0x42   // application provides profile data to be applied to tx
+#define T5X_MSG_PROFILE_DATA_APPLY_MSGID             0x42   // application provides profile data to be applied to tx, Profile_t as of T5X_PROFILE_VERSION.
+                                                            // the 53 byte version 1 payload isn't accepted, a v1 message has no length to
+                                                            // tell the two apart
 #define T5X_MSG_TXDEVICE_PROPERTIES_REQ_MSGID        0x43   // application requests tx device properties from tx
 #define T5X_MSG_TXDEVICE_PROPERTIES_APPLY_MSGID      0x44   // appliaction provides tx device properties to be applied to tx
 #define T5X_MSG_SAVE_CONFIG_TO_EEPROM_MSGID          0x99   // appliaction tells tx to save configuration from RAM to EEPROM
+#define T5X_MSG_PROFILE_SELECT_MSGID                 0x45   // application switches tx to the profile id that follows
+#define T5X_MSG_BAUD_RATE_REQ_MSGID                  0x46   // application asks tx to switch the serial link to the uint32_t baud rate that follows
+#define T5X_MSG_PATCH_APPLY_MSGID                    0x47   // application changes a few bytes of the profile or device properties: struct, offset, length, bytes. v2 frames only
+#define T5X_MSG_REALTIME_SUBSCRIBE_MSGID             0x48   // application subscribes to realtime fields: uint16_t mask of RealtimeField_, uint8_t interval in ms.
+                                                            // a mask of 0 stops the realtime data, without a subscription the whole RealtimeData_t is sent every 60ms
+#define T5X_MSG_BULK_EXPORT_REQ_MSGID                0x49   // application requests all profiles and the device properties as stored in EEPROM
+#define T5X_MSG_BULK_IMPORT_BEGIN_MSGID              0x4A   // application starts to write records to EEPROM. v2 frames only
+#define T5X_MSG_BULK_RECORD_APPLY_MSGID              0x4B   // one record to write: slot, record header, record data. v2 frames only
+#define T5X_MSG_BULK_IMPORT_END_MSGID                0x4C   // number of records written, uint16_t CRC over their messages. the tx reloads its configuration, if NAKed send all again. v2 frames only
+
+#define T5X_PATCH_PROFILE                            0x00   // struct ids of T5X_MSG_PATCH_APPLY_MSGID
+#define T5X_PATCH_TXDEVICE                           0x01
 
 
 
@@ -1,35 +1,98 @@
 #include "util.h"
 #include "TxDeviceProperties.h"
 #include "Profile.h"
+#include "EEPROMQueue.h"
 
 
 int freeRam () 
 {
+#ifdef __AVR__
   extern int __heap_start, *__brkval;
   int v;
   return (int) &v - (__brkval == 0 ? (int) &__heap_start : (int) __brkval);
+#else
+  return 0;   // heap symbols only exist in the avr-libc runtime
+#endif
 }
 
 
 namespace t5x
 {
-#define T5X_EEPROM_VERSION_ADDRESS  1000
-const uint8_t gEEPROM_Version     = 0x01;
 
-bool EEPROMVersionIsInvalid()
+uint16_t crc16(uint16_t aCRC, const void* aData, uint8_t aLength)
 {
-  uint8_t ver;
-  EEPROM_readAnything(T5X_EEPROM_VERSION_ADDRESS, ver); 
-  
-  if (ver!=gEEPROM_Version)
-    return true;
-  else
-    return false;
+  const uint8_t* p = static_cast<const uint8_t*>(aData);
+  while (aLength--)
+  {
+    aCRC ^= uint16_t(*p++) << 8;
+    for (uint8_t i=0; i<8; i++) aCRC = (aCRC & 0x8000) ? (aCRC << 1) ^ 0x1021 : aCRC << 1;
+  }
+  return aCRC;
 }
 
-void SetValidEEPROMVersion()
+
+uint8_t readRecord(uint16_t aAddress, void* aData, uint8_t aMaxLength, uint8_t& aLength)
+{
+  RecordHeader_t header;
+  EEPROM_readAnything(aAddress, header);
+  if (header.Version == 0 || header.Length > aMaxLength) return 0;
+
+  uint8_t* p = static_cast<uint8_t*>(aData);
+  aAddress += sizeof(header);
+  for (uint8_t i=0; i<header.Length; i++) p[i] = EEPROM.read(aAddress+i);
+
+  if (crc16(crc16(0xFFFF, &header, 2), aData, header.Length) != header.CRC) return 0;
+  aLength = header.Length;
+  return header.Version;
+}
+
+
+uint8_t checkRecord(uint16_t aAddress, uint8_t aMaxLength)
+{
+  RecordHeader_t header;
+  EEPROM_readAnything(aAddress, header);
+  if (header.Version == 0 || header.Length > aMaxLength) return 0;
+
+  uint16_t crc = crc16(0xFFFF, &header, 2);
+  aAddress += sizeof(header);
+  for (uint8_t i=0; i<header.Length; i++)
+  {
+    uint8_t b = EEPROM.read(aAddress+i);
+    crc = crc16(crc, &b, 1);
+  }
+  return crc == header.CRC ? header.Version : 0;
+}
+
+
+void writeRecord(uint16_t aAddress, RecordHeader_t& aHeader, uint8_t aVersion, const void* aData, uint8_t aLength)
+{
+  aHeader.Length  = aLength;
+  aHeader.Version = aVersion;
+  aHeader.CRC     = crc16(crc16(0xFFFF, &aHeader, 2), aData, aLength);
+  EEPROMQueue::write(aAddress+sizeof(aHeader), aData, aLength);
+  EEPROMQueue::write(aAddress, &aHeader, sizeof(aHeader));
+}
+
+
+#ifdef T5X_CONDITIONAL_INITIALIZE_EEPROM
+#define T5X_EEPROM_VERSION_ADDRESS  1000   // firmware before records stored the raw structs and a layout version here
+#define T5X_EEPROM_VERSION_RECORDS  0x80   // marks the conversion to records as done
+
+void migrateLegacyEEPROM(TxDeviceProperties& aTxDevice, Profile& aProfile)
+{
+  static const uint8_t sRecords = T5X_EEPROM_VERSION_RECORDS;
+  uint8_t ver = EEPROM.read(T5X_EEPROM_VERSION_ADDRESS);
+  if (ver != 0x01 && ver != 0x02) return;   // 0x01: Profile_t version 1, 0x02: Profile_t version 2
+
+  aTxDevice.migrateLegacy();
+  aProfile.migrateLegacy(ver);
+  EEPROMQueue::write(T5X_EEPROM_VERSION_ADDRESS, &sRecords, sizeof(sRecords));   // queued after the records it vouches for
+  EEPROMQueue::flush();
+}
+#else
+void migrateLegacyEEPROM(TxDeviceProperties& aTxDevice, Profile& aProfile)
 {
-  EEPROM_writeAnything(T5X_EEPROM_VERSION_ADDRESS, gEEPROM_Version); 
 }
+#endif
 
 } // namespace
@@ -27,9 +27,33 @@ template <class T> int EEPROM_readAnything(int ee, T& value)
 
 namespace t5x
 {
-  
-bool EEPROMVersionIsInvalid();
-void SetValidEEPROMVersion();
+
+// Header in front of every record in EEPROM.
+typedef struct
+{
+  uint8_t   Length;     // bytes of data following the header
+  uint8_t   Version;    // layout version of the data, starting at 1
+  uint16_t  CRC;        // CRC-16/CCITT over Length, Version and the data
+} RecordHeader_t;
+
+uint16_t crc16(uint16_t aCRC, const void* aData, uint8_t aLength);
+
+// reads up to aMaxLength bytes of record data into aData.
+// returns the version of the record and its length in aLength, or 0 if the record is invalid.
+uint8_t readRecord(uint16_t aAddress, void* aData, uint8_t aMaxLength, uint8_t& aLength);
+
+// the checks readRecord() makes, without reading the data into RAM.
+// returns the version of the record, or 0 if the record is invalid.
+uint8_t checkRecord(uint16_t aAddress, uint8_t aMaxLength);
+
+// queues a record for writing, aHeader and aData have to stay valid until the EEPROMQueue is idle
+void writeRecord(uint16_t aAddress, RecordHeader_t& aHeader, uint8_t aVersion, const void* aData, uint8_t aLength);
+
+class TxDeviceProperties;
+class Profile;
+
+// converts EEPROM contents from before records were introduced, does nothing once that is done
+void migrateLegacyEEPROM(TxDeviceProperties& aTxDevice, Profile& aProfile);
 
 } // namespace
 
@@ -0,0 +1,106 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Arduino core for host builds, behaves like an Arduino Nano (ATmega328p at 16MHz).
+// Time only passes when the sketch waits (delay, polling a register) or the test advances it, see Host.h.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <type_traits>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+typedef bool     boolean;
+typedef uint8_t  byte;
+typedef uint16_t word;
+
+#define HIGH          0x1
+#define LOW           0x0
+
+#define INPUT         0x0
+#define OUTPUT        0x1
+#define INPUT_PULLUP  0x2
+
+#define DEFAULT       1
+#define EXTERNAL      0
+#define INTERNAL      3
+
+#define LED_BUILTIN   13
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#define NUM_DIGITAL_PINS 20
+#define NUM_ANALOG_INPUTS 8
+
+// the AVR core has macros for these, templates give the same result for mixed types and leave the C++ library usable
+// (decayed, the conditional of two lvalues is a reference to the parameter, which is gone once they return)
+template <typename T, typename U> inline auto min(T a, U b) -> typename std::decay<decltype(a < b ? a : b)>::type { return a < b ? a : b; }
+template <typename T, typename U> inline auto max(T a, U b) -> typename std::decay<decltype(a > b ? a : b)>::type { return a > b ? a : b; }
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define sq(x)        ((x)*(x))
+
+#define lowByte(w)   ((uint8_t) ((w) & 0xff))
+#define highByte(w)  ((uint8_t) ((w) >> 8))
+#define bitRead(value, bit)  (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)   ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) (bitvalue ? bitSet(value, bit) : bitClear(value, bit))
+#define bit(b)       (1UL << (b))
+
+#define interrupts()   sei()
+#define noInterrupts() cli()
+
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+
+// pin mapping of the Nano: D0-D7 on port D, D8-D13 on port B, A0-A7 on port C (A6 and A7 are analog only)
+#define NOT_A_PIN  0
+#define NOT_A_PORT 0
+#define PB 2
+#define PC 3
+#define PD 4
+
+#define digitalPinToPort(p)       ((p) < 8 ? PD : ((p) < 14 ? PB : ((p) < 22 ? PC : NOT_A_PORT)))
+#define digitalPinToBitMask(p)    ((uint8_t)_BV((p) < 8 ? (p) : ((p) < 14 ? (p) - 8 : (p) - 14)))
+#define portInputRegister(P)      ((P) == PB ? &PINB  : ((P) == PC ? &PINC  : ((P) == PD ? &PIND  : (volatile uint8_t*)0)))
+#define portOutputRegister(P)     ((P) == PB ? &PORTB : ((P) == PC ? &PORTC : ((P) == PD ? &PORTD : (volatile uint8_t*)0)))
+#define portModeRegister(P)       ((P) == PB ? &DDRB  : ((P) == PC ? &DDRC  : ((P) == PD ? &DDRD  : (volatile uint8_t*)0)))
+
+#define digitalPinToPCICR(p)      (((p) >= 0 && (p) <= 21) ? &PCICR : (uint8_t*)0)
+#define digitalPinToPCICRbit(p)   (((p) <= 7) ? 2 : (((p) <= 13) ? 0 : 1))
+#define digitalPinToPCMSK(p)      (((p) <= 7) ? &PCMSK2 : (((p) <= 13) ? &PCMSK0 : (((p) <= 21) ? &PCMSK1 : (uint8_t*)0)))
+#define digitalPinToPCMSKbit(p)   (((p) <= 7) ? (p) : (((p) <= 13) ? ((p) - 8) : ((p) - 14)))
+#define digitalPinToInterrupt(p)  ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+
+void          pinMode(uint8_t aPin, uint8_t aMode);
+void          digitalWrite(uint8_t aPin, uint8_t aValue);
+int           digitalRead(uint8_t aPin);
+int           analogRead(uint8_t aPin);
+void          analogReference(uint8_t aMode);
+void          analogWrite(uint8_t aPin, int aValue);
+
+unsigned long millis();
+unsigned long micros();
+void          delay(unsigned long aMs);
+void          delayMicroseconds(unsigned int aUs);
+
+void          setup();
+void          loop();
+
+#include "HardwareSerial.h"
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <stdint.h>
+#include <avr/io.h>
+
+// 1KB EEPROM of the ATmega328p, kept in host::eeprom(). write() waits for the previous write like the AVR library does.
+class EEPROMClass
+{
+  public:
+    uint8_t read(int aAddress);
+    void    write(int aAddress, uint8_t aValue);
+    void    update(int aAddress, uint8_t aValue);
+    uint16_t length() { return E2END + 1; }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
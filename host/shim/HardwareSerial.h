@@ -0,0 +1,34 @@
+#ifndef HOST_HARDWARESERIAL_H
+#define HOST_HARDWARESERIAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SERIAL_RX_BUFFER_SIZE 64
+#define SERIAL_TX_BUFFER_SIZE 64
+
+// USART0 as seen through the Arduino core. Received bytes are queued by the test, see host::serialReceive(),
+// written bytes are collected in host::serialSent().
+class HardwareSerial
+{
+  public:
+    void    begin(unsigned long aBaud);
+    void    end();
+    int     available();
+    int     peek();
+    int     read();
+    int     availableForWrite();
+    void    flush();
+    size_t  write(uint8_t aByte);
+    size_t  write(const uint8_t* aData, size_t aLength);
+    size_t  write(const char* aString);
+    size_t  print(const char* aString);
+    size_t  print(long aValue);
+    size_t  println(const char* aString);
+    size_t  println(long aValue);
+    operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
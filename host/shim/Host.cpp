@@ -0,0 +1,1093 @@
+// Hardware model behind the shim headers: registers, pins, timers, ADC, EEPROM, UART and interrupt dispatch.
+//
+// Time advances in steps that end at the next thing the hardware does by itself: a timer compare match or
+// overflow, the end of an ADC conversion or EEPROM write, a byte on the serial line or an event the test
+// scheduled. After each step the pins are updated and pending interrupts are dispatched.
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "Host.h"
+
+#include <deque>
+#include <map>
+
+
+// register storage, power on values as left by the Arduino core's init()
+
+static void    writeSREG(host::Register8& aRegister, uint8_t aValue);
+static void    writeFlags(host::Register8& aRegister, uint8_t aValue);
+static void    writeADCSRA(host::Register8& aRegister, uint8_t aValue);
+static uint8_t readADCSRA(host::Register8& aRegister);
+static void    writeEECR(host::Register8& aRegister, uint8_t aValue);
+static uint8_t readEECR(host::Register8& aRegister);
+
+host::Register8   SREG(_BV(SREG_I), writeSREG);   // the core enables interrupts before setup()
+host::Register8   TIFR1(0, writeFlags);
+host::Register8   TIFR2(0, writeFlags);
+host::Register8   PCIFR(0, writeFlags);
+host::Register8   EIFR(0, writeFlags);
+host::Register8   ADCSRA(0, writeADCSRA, readADCSRA);
+host::Register8   EECR(0, writeEECR, readEECR);
+
+volatile uint8_t  TCCR1A, TCCR1B, TCCR1C, TIMSK1;
+volatile uint16_t TCNT1, OCR1A, OCR1B, ICR1;
+volatile uint8_t  TCCR2A, TCCR2B, TIMSK2, TCNT2, OCR2A, OCR2B, ASSR;
+volatile uint8_t  PINB, PORTB, DDRB, PINC, PORTC, DDRC, PIND, PORTD, DDRD;
+volatile uint8_t  PCICR, PCMSK0, PCMSK1, PCMSK2, EICRA, EIMSK;
+volatile uint8_t  ADMUX, ADCSRB, DIDR0;
+volatile uint16_t ADC;
+volatile uint8_t  EEDR;
+volatile uint16_t EEAR;
+volatile uint8_t  UCSR0A = _BV(UDRE0), UCSR0B, UCSR0C, UDR0, UBRR0H, UBRR0L;
+
+HardwareSerial    Serial;
+EEPROMClass       EEPROM;
+
+
+namespace
+{
+
+enum
+{
+  PinCount        = 22,
+  CyclesPerMicro  = F_CPU / 1000000UL,
+  PollCycles      = CyclesPerMicro,           // a polling loop iteration
+  EEPROMCycles    = 3300 * CyclesPerMicro,    // one EEPROM cell, erase and write
+  ADCClocks       = 13,                       // per conversion
+  EntryCycles     = 7,                        // interrupt response and the jump in the vector table
+  ReturnCycles    = 4,                        // reti
+  SerialFrameBits = 10,                       // start, 8 data, stop
+  RxFifoSize      = 2                         // UDR0 receive buffer of the USART
+};
+
+// compare output units and the pins they drive
+enum
+{
+  OC1A,
+  OC1B,
+  OC2A,
+  OC2B,
+  OCCount
+};
+
+const uint8_t sc_OCPin[OCCount] = {9, 10, 11, 3};
+const uint8_t ICP1Pin           = 8;
+
+
+host::Vector_t  s_Vectors[_VECTORS_SIZE];     // filled by the ISR() macro during static initialization
+uint16_t        s_ISRCycles[_VECTORS_SIZE];   // time spent in each handler, set by the test
+uint32_t        s_ISRCount[_VECTORS_SIZE];
+uint8_t         s_AccessCycles  = 0;
+
+uint64_t        s_Cycles        = 0;
+uint32_t        s_Timer1Rest    = 0;          // cycles not yet counted by the prescalers
+uint32_t        s_Timer2Rest    = 0;
+bool            s_OC[OCCount];                // output compare latches
+
+uint8_t         s_Driven[3];                  // per port D, B, C: pins driven from outside
+uint8_t         s_DrivenHigh[3];              // and their level
+uint8_t         s_Levels[3];                  // last levels seen, for edge detection
+bool            s_Traced[PinCount];
+std::vector<host::Edge> s_Edges[PinCount];
+uint16_t        s_Analog[8];
+
+uint64_t        s_ADCDone       = 0;          // end of the running conversion, 0 if none
+uint64_t        s_EEPROMDone    = 0;          // end of the running write, 0 if none
+uint8_t         s_EEPROM[E2END + 1];
+uint32_t        s_EEPROMWrites[E2END + 1];
+bool            s_EEPROMErased  = false;      // set once the cells hold 0xFF, like a new chip
+
+struct Event
+{
+  host::Callback_t Callback;
+  void*            User;
+  int8_t           Pin;                       // >= 0 for setPinAt
+  bool             High;
+};
+
+std::multimap<uint64_t, Event> s_Events;      // equal times keep the order they were scheduled in
+
+unsigned long         s_SerialBaud = 0;
+std::deque<uint8_t>   s_SerialWire;           // on their way to RX
+uint64_t              s_RxNext     = 0;       // arrival of the first byte on the wire, 0 if none
+std::deque<uint8_t>   s_RxFifo;               // received by the USART, not yet taken by the RX interrupt
+std::deque<uint8_t>   s_SerialRx;             // ring buffer of the core
+uint32_t              s_Overruns   = 0;
+std::deque<uint8_t>   s_SerialTxBuffer;       // ring buffer of the core
+bool                  s_TxUDR      = false;   // UDR0 holds a byte for the shift register
+uint8_t               s_TxUDRValue = 0;
+uint64_t              s_TxDone     = 0;       // end of the byte in the shift register, 0 if idle
+uint8_t               s_TxShift    = 0;
+std::vector<uint8_t>  s_SerialTx;
+
+
+struct Port
+{
+  volatile uint8_t* Pin;
+  volatile uint8_t* Port;
+  volatile uint8_t* Ddr;
+  uint8_t           Index;                    // into the per port state, D, B, C like the pin numbers
+  uint8_t           Bit;
+};
+
+Port portOf(uint8_t aPin)
+{
+  Port p;
+  if (aPin < 8)       { p.Pin = &PIND; p.Port = &PORTD; p.Ddr = &DDRD; p.Index = 0; p.Bit = aPin; }
+  else if (aPin < 14) { p.Pin = &PINB; p.Port = &PORTB; p.Ddr = &DDRB; p.Index = 1; p.Bit = aPin - 8; }
+  else                { p.Pin = &PINC; p.Port = &PORTC; p.Ddr = &DDRC; p.Index = 2; p.Bit = aPin - 14; }
+  return p;
+}
+
+const uint8_t sc_FirstPin[3] = {0, 8, 14};
+
+
+uint8_t* cells()
+{
+  if (!s_EEPROMErased)
+  {
+    memset(s_EEPROM, 0xFF, sizeof(s_EEPROM));
+    s_EEPROMErased = true;
+  }
+  return s_EEPROM;
+}
+
+
+uint8_t compareOutputMode(uint8_t aUnit)
+{
+  switch (aUnit)
+  {
+    case OC1A: return (TCCR1A >> COM1A0) & 0x03;
+    case OC1B: return (TCCR1A >> COM1B0) & 0x03;
+    case OC2A: return (TCCR2A >> COM2A0) & 0x03;
+    default:   return (TCCR2A >> COM2B0) & 0x03;
+  }
+}
+
+
+void pinChanged(uint8_t aPin, bool aHigh)
+{
+  if (s_Traced[aPin])
+  {
+    host::Edge e = {s_Cycles, aHigh};
+    s_Edges[aPin].push_back(e);
+  }
+
+  // pin change interrupts: PORTB is PCINT0-5, PORTC PCINT8-13, PORTD PCINT16-23
+  if (aPin < 8)       { if (PCMSK2 & _BV(aPin))      PCIFR.m_Value |= _BV(PCIF2); }
+  else if (aPin < 14) { if (PCMSK0 & _BV(aPin - 8))  PCIFR.m_Value |= _BV(PCIF0); }
+  else if (aPin < 20) { if (PCMSK1 & _BV(aPin - 14)) PCIFR.m_Value |= _BV(PCIF1); }
+
+  // external interrupts on any change (1), falling (2) or rising (3) edges
+  if (aPin == 2 || aPin == 3)
+  {
+    uint8_t sense = (EICRA >> (aPin == 2 ? ISC00 : ISC10)) & 0x03;
+    if (sense == 1 || (sense == 2 && !aHigh) || (sense == 3 && aHigh))
+      EIFR.m_Value |= _BV(aPin == 2 ? INTF0 : INTF1);
+  }
+
+  // input capture latches the counter at the selected edge
+  if (aPin == ICP1Pin && aHigh == bool(TCCR1B & _BV(ICES1)))
+  {
+    ICR1 = TCNT1;
+    TIFR1.m_Value |= _BV(ICF1);
+  }
+}
+
+
+// brings the PIN registers up to date, also after the sketch wrote PORT or DDR itself.
+// An output drives its PORT bit, or its compare output unit if that is connected,
+// an input follows the outside or its pull-up.
+void refreshPins()
+{
+  for (uint8_t i = 0; i < 3; ++i)
+  {
+    Port p = portOf(sc_FirstPin[i]);
+    uint8_t ddr    = *p.Ddr;
+    uint8_t levels = (*p.Port & ~s_Driven[i]) | (s_DrivenHigh[i] & s_Driven[i]);
+    levels = (levels & ~ddr) | (*p.Port & ddr);
+    for (uint8_t u = 0; u < OCCount; ++u)
+    {
+      Port oc = portOf(sc_OCPin[u]);
+      if (oc.Index != i || !(ddr & _BV(oc.Bit)) || compareOutputMode(u) == 0) continue;
+      if (s_OC[u]) levels |= _BV(oc.Bit);
+      else         levels &= ~_BV(oc.Bit);
+    }
+
+    uint8_t changed = levels ^ s_Levels[i];
+    s_Levels[i] = levels;
+    for (uint8_t bit = 0; changed != 0; ++bit, changed >>= 1)
+    {
+      if (changed & 1) pinChanged(sc_FirstPin[i] + bit, levels & _BV(bit));
+    }
+    *p.Pin = levels;
+  }
+
+  // a low level on INT0/INT1 keeps requesting as long as it lasts
+  if ((EICRA & 0x03) == 0 && !(s_Levels[0] & _BV(2)))            EIFR.m_Value |= _BV(INTF0);
+  if (((EICRA >> ISC10) & 0x03) == 0 && !(s_Levels[0] & _BV(3)))  EIFR.m_Value |= _BV(INTF1);
+}
+
+
+// drives a pin from outside, or lets go of it
+void drive(uint8_t aPin, bool aDriven, bool aHigh)
+{
+  Port p = portOf(aPin);
+  uint8_t mask = _BV(p.Bit);
+  if (aDriven) s_Driven[p.Index] |= mask;
+  else         s_Driven[p.Index] &= ~mask;
+  if (aHigh)   s_DrivenHigh[p.Index] |= mask;
+  else         s_DrivenHigh[p.Index] &= ~mask;
+  refreshPins();
+}
+
+
+bool eepromBusy()
+{
+  return s_EEPROMDone != 0;
+}
+
+
+// highest priority interrupt that is enabled and pending, 0 if none
+uint8_t pendingVector()
+{
+  uint8_t f;
+  if ((f = EIFR.m_Value & EIMSK))
+    return f & _BV(INTF0) ? INT0_vect_num : INT1_vect_num;
+  if ((f = PCIFR.m_Value & PCICR))
+    return f & _BV(PCIF0) ? PCINT0_vect_num : (f & _BV(PCIF1) ? PCINT1_vect_num : PCINT2_vect_num);
+  if ((f = TIFR2.m_Value & TIMSK2))
+    return f & _BV(OCF2A) ? TIMER2_COMPA_vect_num : (f & _BV(OCF2B) ? TIMER2_COMPB_vect_num : TIMER2_OVF_vect_num);
+  if ((f = TIFR1.m_Value & TIMSK1 & (_BV(ICF1) | _BV(OCF1A) | _BV(OCF1B) | _BV(TOV1))))
+  {
+    if (f & _BV(ICF1))  return TIMER1_CAPT_vect_num;
+    if (f & _BV(OCF1A)) return TIMER1_COMPA_vect_num;
+    if (f & _BV(OCF1B)) return TIMER1_COMPB_vect_num;
+    return TIMER1_OVF_vect_num;
+  }
+  if (s_SerialBaud != 0 && !s_RxFifo.empty()) return USART_RX_vect_num;
+  if (s_SerialBaud != 0 && !s_TxUDR && !s_SerialTxBuffer.empty()) return USART_UDRE_vect_num;
+  if ((ADCSRA.m_Value & _BV(ADIF)) && (ADCSRA.m_Value & _BV(ADIE))) return ADC_vect_num;
+  if ((EECR.m_Value & _BV(EERIE)) && !eepromBusy()) return EE_READY_vect_num;
+  return 0;
+}
+
+
+// the hardware clears the flag of an interrupt when its handler is entered
+void acknowledge(uint8_t aVector)
+{
+  switch (aVector)
+  {
+    case INT0_vect_num:         EIFR.m_Value  &= ~_BV(INTF0); break;
+    case INT1_vect_num:         EIFR.m_Value  &= ~_BV(INTF1); break;
+    case PCINT0_vect_num:       PCIFR.m_Value &= ~_BV(PCIF0); break;
+    case PCINT1_vect_num:       PCIFR.m_Value &= ~_BV(PCIF1); break;
+    case PCINT2_vect_num:       PCIFR.m_Value &= ~_BV(PCIF2); break;
+    case TIMER2_COMPA_vect_num: TIFR2.m_Value &= ~_BV(OCF2A); break;
+    case TIMER2_COMPB_vect_num: TIFR2.m_Value &= ~_BV(OCF2B); break;
+    case TIMER2_OVF_vect_num:   TIFR2.m_Value &= ~_BV(TOV2);  break;
+    case TIMER1_CAPT_vect_num:  TIFR1.m_Value &= ~_BV(ICF1);  break;
+    case TIMER1_COMPA_vect_num: TIFR1.m_Value &= ~_BV(OCF1A); break;
+    case TIMER1_COMPB_vect_num: TIFR1.m_Value &= ~_BV(OCF1B); break;
+    case TIMER1_OVF_vect_num:   TIFR1.m_Value &= ~_BV(TOV1);  break;
+    case ADC_vect_num:          ADCSRA.m_Value &= ~_BV(ADIF); break;
+    default:                    break;   // level triggered, no flag
+  }
+}
+
+
+void startTransmit();
+
+// the core's USART handlers, they move bytes between UDR0 and its ring buffers
+void serialRxISR()
+{
+  uint8_t b = s_RxFifo.front();
+  s_RxFifo.pop_front();
+  if (s_SerialRx.size() < SERIAL_RX_BUFFER_SIZE - 1) s_SerialRx.push_back(b);   // dropped if the buffer is full
+}
+
+
+void serialUdreISR()
+{
+  s_TxUDRValue = s_SerialTxBuffer.front();
+  s_SerialTxBuffer.pop_front();
+  s_TxUDR = true;
+  startTransmit();
+}
+
+
+host::Vector_t handlerOf(uint8_t aVector)
+{
+  if (aVector == USART_RX_vect_num)   return serialRxISR;
+  if (aVector == USART_UDRE_vect_num) return serialUdreISR;
+  return s_Vectors[aVector];
+}
+
+
+void elapse(uint64_t aCycles);
+
+// runs pending interrupts while they are enabled, like the AVR does between two instructions.
+// The handler is entered after the interrupt response time and occupies the CPU for the time set
+// with setISRCycles, so anything that becomes due meanwhile has to wait, as on the chip.
+void service()
+{
+  refreshPins();
+  uint8_t vector;
+  while ((SREG.m_Value & _BV(SREG_I)) && (vector = pendingVector()) != 0)
+  {
+    acknowledge(vector);
+    host::Vector_t handler = handlerOf(vector);
+    if (handler == 0)
+    {
+      if (vector == EE_READY_vect_num) EECR.m_Value &= ~_BV(EERIE);   // nobody listens, it would fire forever
+      continue;
+    }
+    SREG.m_Value &= ~_BV(SREG_I);   // entering the handler
+    ++s_ISRCount[vector];
+    elapse(EntryCycles);
+    handler();
+    elapse(s_ISRCycles[vector] + ReturnCycles);
+    SREG.m_Value |= _BV(SREG_I);    // reti
+  }
+}
+
+
+// the sketch's own instructions between two accesses to the hardware
+void touch()
+{
+  if (s_AccessCycles != 0) elapse(s_AccessCycles);
+  else                     service();
+}
+
+
+const uint16_t sc_Timer1Prescaler[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+const uint16_t sc_Timer2Prescaler[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+// ticks of a counter until it reaches aValue, a full period if it is there already
+uint32_t ticksUntil(uint16_t aValue, uint16_t aCount, uint32_t aTop)
+{
+  uint32_t ticks = (uint32_t(aValue) - aCount) & aTop;
+  return ticks == 0 ? aTop + 1 : ticks;
+}
+
+
+// cycles until the next compare match or overflow of a running timer, 0 if both are stopped
+uint64_t timerCycles()
+{
+  uint64_t next = 0;
+  uint16_t pre1 = sc_Timer1Prescaler[TCCR1B & 0x07];
+  if (pre1 != 0)
+  {
+    uint32_t ticks = ticksUntil(0, TCNT1, 0xFFFF);
+    if (ticksUntil(OCR1A, TCNT1, 0xFFFF) < ticks) ticks = ticksUntil(OCR1A, TCNT1, 0xFFFF);
+    if (ticksUntil(OCR1B, TCNT1, 0xFFFF) < ticks) ticks = ticksUntil(OCR1B, TCNT1, 0xFFFF);
+    next = uint64_t(ticks) * pre1 - s_Timer1Rest;
+  }
+  uint16_t pre2 = sc_Timer2Prescaler[TCCR2B & 0x07];
+  if (pre2 != 0)
+  {
+    uint32_t ticks = ticksUntil(0, TCNT2, 0xFF);
+    if (ticksUntil(OCR2A, TCNT2, 0xFF) < ticks) ticks = ticksUntil(OCR2A, TCNT2, 0xFF);
+    if (ticksUntil(OCR2B, TCNT2, 0xFF) < ticks) ticks = ticksUntil(OCR2B, TCNT2, 0xFF);
+    uint64_t cycles = uint64_t(ticks) * pre2 - s_Timer2Rest;
+    if (next == 0 || cycles < next) next = cycles;
+  }
+  return next;
+}
+
+
+// what a compare match does to its output, COMnx bits 01 toggle, 10 clear, 11 set
+void compareOutput(uint8_t aUnit)
+{
+  switch (compareOutputMode(aUnit))
+  {
+    case 1: s_OC[aUnit] = !s_OC[aUnit]; break;
+    case 2: s_OC[aUnit] = false;        break;
+    case 3: s_OC[aUnit] = true;         break;
+  }
+}
+
+
+// true if the counter passed aValue while counting aTicks from aCount
+bool passed(uint16_t aValue, uint16_t aCount, uint32_t aTicks, uint32_t aTop)
+{
+  return ((uint32_t(aValue) - aCount - 1) & aTop) < aTicks;
+}
+
+
+// normal mode only, the counters run from 0 to TOP and wrap, which is all the library uses
+void countTimers(uint64_t aCycles)
+{
+  uint16_t pre1 = sc_Timer1Prescaler[TCCR1B & 0x07];
+  if (pre1 != 0)
+  {
+    uint64_t total = s_Timer1Rest + aCycles;
+    uint32_t ticks = total / pre1;
+    s_Timer1Rest   = total % pre1;
+    uint16_t count = TCNT1;
+    if (passed(OCR1A, count, ticks, 0xFFFF)) { TIFR1.m_Value |= _BV(OCF1A); compareOutput(OC1A); }
+    if (passed(OCR1B, count, ticks, 0xFFFF)) { TIFR1.m_Value |= _BV(OCF1B); compareOutput(OC1B); }
+    if (passed(0, count, ticks, 0xFFFF))       TIFR1.m_Value |= _BV(TOV1);
+    TCNT1 = count + ticks;
+  }
+  uint16_t pre2 = sc_Timer2Prescaler[TCCR2B & 0x07];
+  if (pre2 != 0)
+  {
+    uint64_t total = s_Timer2Rest + aCycles;
+    uint32_t ticks = total / pre2;
+    s_Timer2Rest   = total % pre2;
+    uint8_t count  = TCNT2;
+    if (passed(OCR2A, count, ticks, 0xFF)) { TIFR2.m_Value |= _BV(OCF2A); compareOutput(OC2A); }
+    if (passed(OCR2B, count, ticks, 0xFF)) { TIFR2.m_Value |= _BV(OCF2B); compareOutput(OC2B); }
+    if (passed(0, count, ticks, 0xFF))       TIFR2.m_Value |= _BV(TOV2);
+    TCNT2 = count + ticks;
+  }
+}
+
+
+uint64_t serialFrameCycles()
+{
+  return uint64_t(SerialFrameBits) * F_CPU / s_SerialBaud;
+}
+
+
+void startTransmit()
+{
+  if (s_TxDone != 0 || !s_TxUDR) return;
+  s_TxShift  = s_TxUDRValue;
+  s_TxUDR    = false;
+  s_TxDone   = s_Cycles + serialFrameCycles();
+}
+
+
+void completeConversion()
+{
+  uint8_t channel = ADMUX & 0x0F;
+  ADC = channel < 8 ? s_Analog[channel] : (channel == 14 ? 225 : 0);   // 1.1V bandgap against 5V, or GND
+  ADCSRA.m_Value = (ADCSRA.m_Value & ~_BV(ADSC)) | _BV(ADIF);
+  s_ADCDone = 0;
+}
+
+
+void completeEEPROMWrite()
+{
+  EECR.m_Value &= ~_BV(EEPE);
+  s_EEPROMDone = 0;
+}
+
+
+// everything that is due by now
+void settle()
+{
+  if (s_ADCDone != 0 && s_Cycles >= s_ADCDone)       completeConversion();
+  if (s_EEPROMDone != 0 && s_Cycles >= s_EEPROMDone) completeEEPROMWrite();
+
+  while (s_RxNext != 0 && s_Cycles >= s_RxNext)
+  {
+    if (s_RxFifo.size() < RxFifoSize) s_RxFifo.push_back(s_SerialWire.front());
+    else                              ++s_Overruns;
+    s_SerialWire.pop_front();
+    s_RxNext = s_SerialWire.empty() ? 0 : s_RxNext + serialFrameCycles();
+  }
+
+  if (s_TxDone != 0 && s_Cycles >= s_TxDone)
+  {
+    s_SerialTx.push_back(s_TxShift);
+    s_TxDone = 0;
+    startTransmit();
+  }
+
+  while (!s_Events.empty() && s_Events.begin()->first <= s_Cycles)
+  {
+    Event e = s_Events.begin()->second;
+    s_Events.erase(s_Events.begin());
+    if (e.Pin >= 0)
+    {
+      drive(e.Pin, true, e.High);
+    }
+    else
+    {
+      e.Callback(e.User);
+    }
+  }
+
+  service();
+}
+
+
+void limit(uint64_t& aStep, uint64_t aAt)
+{
+  if (aAt != 0 && aAt > s_Cycles && aAt - s_Cycles < aStep) aStep = aAt - s_Cycles;
+}
+
+
+// Time passes in steps that end where the hardware does something, interrupts are serviced after each step.
+// Handlers and scheduled events may let time pass themselves, the loop only stops at the target.
+void elapse(uint64_t aCycles)
+{
+  uint64_t target = s_Cycles + aCycles;
+  settle();
+  while (s_Cycles < target)
+  {
+    uint64_t step = target - s_Cycles;
+    limit(step, s_ADCDone);
+    limit(step, s_EEPROMDone);
+    limit(step, s_RxNext);
+    limit(step, s_TxDone);
+    if (!s_Events.empty()) limit(step, s_Events.begin()->first);
+    uint64_t timer = timerCycles();
+    if (timer != 0 && timer < step) step = timer;
+
+    countTimers(step);
+    s_Cycles += step;
+    settle();
+  }
+}
+
+
+void writeCell(uint16_t aAddress, uint8_t aValue)
+{
+  aAddress &= E2END;
+  cells()[aAddress] = aValue;
+  ++s_EEPROMWrites[aAddress];
+  s_EEPROMDone = s_Cycles + EEPROMCycles;
+  EECR.m_Value |= _BV(EEPE);
+}
+
+
+void waitForEEPROM()
+{
+  while (eepromBusy()) elapse(s_EEPROMDone - s_Cycles);
+}
+
+
+// nothing changes for a waiting writer before the byte on the line is out
+void waitForTransmit()
+{
+  elapse(s_TxDone > s_Cycles ? s_TxDone - s_Cycles : uint64_t(PollCycles));
+}
+
+
+void schedule(uint64_t aCycle, const Event& aEvent)
+{
+  s_Events.insert(std::make_pair(aCycle, aEvent));
+}
+
+} // namespace
+
+
+// register hooks
+
+static void writeSREG(host::Register8& aRegister, uint8_t aValue)
+{
+  aRegister.m_Value = aValue;
+  touch();
+}
+
+
+// interrupt flags are cleared by writing a one
+static void writeFlags(host::Register8& aRegister, uint8_t aValue)
+{
+  aRegister.m_Value &= ~aValue;
+}
+
+
+static void writeADCSRA(host::Register8& aRegister, uint8_t aValue)
+{
+  uint8_t flags = (aRegister.m_Value & ~aValue) & _BV(ADIF);   // ADIF is cleared by writing a one
+  bool start = (aValue & _BV(ADSC)) && (aValue & _BV(ADEN)) && s_ADCDone == 0;
+  aRegister.m_Value = (aValue & ~(_BV(ADIF) | _BV(ADSC))) | flags | (s_ADCDone != 0 ? _BV(ADSC) : 0);
+  if (start)
+  {
+    uint8_t prescaler = aValue & 0x07;
+    s_ADCDone = s_Cycles + (uint32_t(ADCClocks) << (prescaler == 0 ? 1 : prescaler));
+    aRegister.m_Value |= _BV(ADSC);
+  }
+  touch();
+}
+
+
+static uint8_t readADCSRA(host::Register8& aRegister)
+{
+  if (s_ADCDone != 0) elapse(s_ADCDone - s_Cycles);   // the busy loop ends when the conversion does
+  return aRegister.m_Value;
+}
+
+
+static void writeEECR(host::Register8& aRegister, uint8_t aValue)
+{
+  uint8_t old = aRegister.m_Value;
+  aRegister.m_Value = (aValue & (_BV(EERIE) | _BV(EEMPE))) | (old & _BV(EEPE));
+  if ((aValue & _BV(EEPE)) && (old & _BV(EEMPE)) && !eepromBusy())
+  {
+    aRegister.m_Value &= ~_BV(EEMPE);
+    writeCell(EEAR, EEDR);
+  }
+  if ((aValue & _BV(EERE)) && !eepromBusy()) EEDR = cells()[EEAR & E2END];
+  touch();
+}
+
+
+static uint8_t readEECR(host::Register8& aRegister)
+{
+  if (eepromBusy()) elapse(s_EEPROMDone - s_Cycles);   // the busy loop ends when the write does
+  return aRegister.m_Value;
+}
+
+
+// interrupt vectors
+
+host::VectorEntry::VectorEntry(uint8_t aNumber, Vector_t aHandler)
+{
+  s_Vectors[aNumber] = aHandler;
+}
+
+
+// Arduino core
+
+void pinMode(uint8_t aPin, uint8_t aMode)
+{
+  if (aPin >= PinCount) return;
+  Port p = portOf(aPin);
+  uint8_t mask = _BV(p.Bit);
+  if (aMode == OUTPUT) *p.Ddr |= mask;
+  else
+  {
+    *p.Ddr &= ~mask;
+    if (aMode == INPUT_PULLUP) *p.Port |= mask;
+    else                       *p.Port &= ~mask;
+  }
+  touch();
+}
+
+
+void digitalWrite(uint8_t aPin, uint8_t aValue)
+{
+  if (aPin >= PinCount) return;
+  Port p = portOf(aPin);
+  if (aValue) *p.Port |= _BV(p.Bit);
+  else        *p.Port &= ~_BV(p.Bit);
+  touch();
+}
+
+
+int digitalRead(uint8_t aPin)
+{
+  touch();
+  if (aPin >= PinCount) return LOW;
+  Port p = portOf(aPin);
+  return (*p.Pin & _BV(p.Bit)) ? HIGH : LOW;
+}
+
+
+// a blocking conversion, like the core does it
+int analogRead(uint8_t aPin)
+{
+  if (aPin >= A0) aPin -= A0;
+  ADMUX = (ADMUX & 0xF0) | (aPin & 0x07);
+  ADCSRA |= _BV(ADEN) | _BV(ADSC) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+  while (ADCSRA & _BV(ADSC)) ;
+  return ADC;
+}
+
+
+void analogReference(uint8_t)
+{
+}
+
+
+void analogWrite(uint8_t aPin, int aValue)
+{
+  pinMode(aPin, OUTPUT);
+  digitalWrite(aPin, aValue >= 128 ? HIGH : LOW);
+}
+
+
+unsigned long millis()
+{
+  touch();
+  return (unsigned long)(s_Cycles / (F_CPU / 1000UL));
+}
+
+
+unsigned long micros()
+{
+  touch();
+  return (unsigned long)(s_Cycles / CyclesPerMicro);
+}
+
+
+void delay(unsigned long aMs)
+{
+  elapse(uint64_t(aMs) * (F_CPU / 1000UL));
+}
+
+
+void delayMicroseconds(unsigned int aUs)
+{
+  elapse(uint64_t(aUs) * CyclesPerMicro);
+}
+
+
+// flash strings are plain strings, only %S has to become %s
+
+static void convertFormat(const char* aFormat, char* aBuffer, size_t aSize)
+{
+  size_t n = 0;
+  for (; *aFormat && n + 1 < aSize; ++aFormat, ++n)
+  {
+    aBuffer[n] = *aFormat;
+    if (aFormat[0] == '%' && aFormat[1] == 'S' && n + 2 < aSize)
+    {
+      aBuffer[++n] = 's';
+      ++aFormat;
+    }
+  }
+  aBuffer[n] = 0;
+}
+
+
+int vfprintf_P(FILE* aStream, const char* aFormat, va_list aArgs)
+{
+  char format[256];
+  convertFormat(aFormat, format, sizeof(format));
+  return vfprintf(aStream, format, aArgs);
+}
+
+
+int fprintf_P(FILE* aStream, const char* aFormat, ...)
+{
+  va_list args;
+  va_start(args, aFormat);
+  int n = vfprintf_P(aStream, aFormat, args);
+  va_end(args);
+  return n;
+}
+
+
+int printf_P(const char* aFormat, ...)
+{
+  va_list args;
+  va_start(args, aFormat);
+  int n = vfprintf_P(stdout, aFormat, args);
+  va_end(args);
+  return n;
+}
+
+
+// Serial, the core's buffered USART driver
+
+void HardwareSerial::begin(unsigned long aBaud)
+{
+  s_SerialBaud = aBaud;
+  touch();
+}
+
+
+void HardwareSerial::end()
+{
+  flush();
+  s_SerialBaud = 0;
+  s_SerialRx.clear();
+  s_RxFifo.clear();
+}
+
+
+int HardwareSerial::available()
+{
+  touch();
+  return s_SerialRx.size();
+}
+
+
+int HardwareSerial::peek()
+{
+  touch();
+  return s_SerialRx.empty() ? -1 : s_SerialRx.front();
+}
+
+
+int HardwareSerial::read()
+{
+  touch();
+  if (s_SerialRx.empty()) return -1;
+  uint8_t b = s_SerialRx.front();
+  s_SerialRx.pop_front();
+  return b;
+}
+
+
+int HardwareSerial::availableForWrite()
+{
+  touch();
+  return SERIAL_TX_BUFFER_SIZE - 1 - s_SerialTxBuffer.size();
+}
+
+
+void HardwareSerial::flush()
+{
+  while (s_SerialBaud != 0 && (!s_SerialTxBuffer.empty() || s_TxUDR || s_TxDone != 0))
+  {
+    if (!(SREG.m_Value & _BV(SREG_I)) && !s_TxUDR && !s_SerialTxBuffer.empty()) serialUdreISR();
+    waitForTransmit();
+  }
+}
+
+
+// like the core: straight into UDR0 if everything is idle, otherwise into the ring buffer,
+// waiting for room if it is full. With interrupts off the core empties UDR0 itself.
+size_t HardwareSerial::write(uint8_t aByte)
+{
+  if (s_SerialBaud == 0)
+  {
+    s_SerialTx.push_back(aByte);
+    touch();
+    return 1;
+  }
+  if (s_SerialTxBuffer.empty() && !s_TxUDR)
+  {
+    s_TxUDRValue = aByte;
+    s_TxUDR      = true;
+    startTransmit();
+    touch();
+    return 1;
+  }
+  while (s_SerialTxBuffer.size() >= SERIAL_TX_BUFFER_SIZE - 1)
+  {
+    if (!(SREG.m_Value & _BV(SREG_I)) && !s_TxUDR) serialUdreISR();
+    waitForTransmit();
+  }
+  s_SerialTxBuffer.push_back(aByte);
+  touch();
+  return 1;
+}
+
+
+size_t HardwareSerial::write(const uint8_t* aData, size_t aLength)
+{
+  for (size_t i = 0; i < aLength; ++i) write(aData[i]);
+  return aLength;
+}
+
+
+size_t HardwareSerial::write(const char* aString)
+{
+  return write(reinterpret_cast<const uint8_t*>(aString), strlen(aString));
+}
+
+
+size_t HardwareSerial::print(const char* aString)
+{
+  return write(aString);
+}
+
+
+size_t HardwareSerial::print(long aValue)
+{
+  char text[12];
+  snprintf(text, sizeof(text), "%ld", aValue);
+  return write(text);
+}
+
+
+size_t HardwareSerial::println(const char* aString)
+{
+  return print(aString) + write("\r\n");
+}
+
+
+size_t HardwareSerial::println(long aValue)
+{
+  return print(aValue) + write("\r\n");
+}
+
+
+// EEPROM library
+
+uint8_t EEPROMClass::read(int aAddress)
+{
+  waitForEEPROM();
+  return cells()[aAddress & E2END];
+}
+
+
+void EEPROMClass::write(int aAddress, uint8_t aValue)
+{
+  waitForEEPROM();
+  writeCell(aAddress, aValue);
+  touch();
+}
+
+
+void EEPROMClass::update(int aAddress, uint8_t aValue)
+{
+  if (read(aAddress) != aValue) write(aAddress, aValue);
+}
+
+
+// test side
+
+namespace host
+{
+
+uint64_t cycles()
+{
+  return s_Cycles;
+}
+
+
+uint64_t microseconds()
+{
+  return s_Cycles / CyclesPerMicro;
+}
+
+
+void advance(uint32_t aMicros)
+{
+  elapse(uint64_t(aMicros) * CyclesPerMicro);
+}
+
+
+void advanceCycles(uint32_t aCycles)
+{
+  elapse(aCycles);
+}
+
+
+void at(uint64_t aCycle, Callback_t aCallback, void* aUser)
+{
+  Event e = {aCallback, aUser, -1, false};
+  schedule(aCycle, e);
+}
+
+
+void setAccessCycles(uint8_t aCycles)
+{
+  s_AccessCycles = aCycles;
+}
+
+
+void setISRCycles(uint8_t aVector, uint16_t aCycles)
+{
+  if (aVector < _VECTORS_SIZE) s_ISRCycles[aVector] = aCycles;
+}
+
+
+uint32_t isrCount(uint8_t aVector)
+{
+  return aVector < _VECTORS_SIZE ? s_ISRCount[aVector] : 0;
+}
+
+
+void setPin(uint8_t aPin, bool aHigh)
+{
+  if (aPin >= PinCount) return;
+  drive(aPin, true, aHigh);
+}
+
+
+void setPinAt(uint64_t aCycle, uint8_t aPin, bool aHigh)
+{
+  if (aPin >= PinCount) return;
+  Event e = {0, 0, int8_t(aPin), aHigh};
+  schedule(aCycle, e);
+}
+
+
+void releasePin(uint8_t aPin)
+{
+  if (aPin >= PinCount) return;
+  drive(aPin, false, false);
+}
+
+
+bool getPin(uint8_t aPin)
+{
+  if (aPin >= PinCount) return false;
+  refreshPins();
+  Port p = portOf(aPin);
+  return s_Levels[p.Index] & _BV(p.Bit);
+}
+
+
+void tracePin(uint8_t aPin, bool aEnable)
+{
+  if (aPin >= PinCount) return;
+  refreshPins();
+  s_Traced[aPin] = aEnable;
+}
+
+
+std::vector<Edge>& pinEdges(uint8_t aPin)
+{
+  return s_Edges[aPin < PinCount ? aPin : 0];
+}
+
+
+void setAnalog(uint8_t aPin, uint16_t aValue)
+{
+  if (aPin >= A0) aPin -= A0;
+  if (aPin < 8) s_Analog[aPin] = aValue & 0x3FF;
+}
+
+
+// bytes follow each other on the line without a gap, before Serial.begin() they are in the buffer at once
+void serialReceive(const void* aData, size_t aLength)
+{
+  const uint8_t* data = static_cast<const uint8_t*>(aData);
+  for (size_t i = 0; i < aLength; ++i)
+  {
+    if (s_SerialBaud == 0)
+    {
+      if (s_SerialRx.size() < SERIAL_RX_BUFFER_SIZE - 1) s_SerialRx.push_back(data[i]);   // the core keeps one slot free
+      continue;
+    }
+    if (s_SerialWire.empty()) s_RxNext = s_Cycles + serialFrameCycles();
+    s_SerialWire.push_back(data[i]);
+  }
+}
+
+
+void serialReceive(const std::vector<uint8_t>& aData)
+{
+  serialReceive(aData.data(), aData.size());
+}
+
+
+std::vector<uint8_t>& serialSent()
+{
+  return s_SerialTx;
+}
+
+
+size_t serialPending()
+{
+  return s_SerialTxBuffer.size() + (s_TxUDR ? 1 : 0) + (s_TxDone != 0 ? 1 : 0);
+}
+
+
+uint32_t serialOverruns()
+{
+  return s_Overruns;
+}
+
+
+unsigned long serialBaud()
+{
+  return s_SerialBaud;
+}
+
+
+uint8_t* eeprom()
+{
+  return cells();
+}
+
+
+uint32_t eepromWrites(uint16_t aAddress)
+{
+  return s_EEPROMWrites[aAddress & E2END];
+}
+
+} // namespace end
@@ -0,0 +1,66 @@
+#ifndef HOST_HOST_H
+#define HOST_HOST_H
+
+// Control of the simulated Nano from the test side: time, pins, analog inputs, serial link and EEPROM.
+// The sketch sees all of this through the Arduino functions and the AVR registers of the shim.
+//
+// Time is counted in CPU cycles at F_CPU, it only passes when the sketch waits (delay(), EEPROM writes,
+// polling EECR/ADCSRA, a full serial buffer), when an interrupt handler runs or when the test calls advance().
+// While it passes, Timer1 and Timer2 count in normal mode and raise their compare match and overflow flags,
+// OC1A/OC1B/OC2A/OC2B drive their pins, ICP1 latches edges, pin changes raise PCINT/INT flags, the ADC and
+// EEPROM finish and bytes move over the serial line at the baud rate.
+//
+// Pending interrupts are dispatched in the order of their vector numbers whenever time passes and whenever
+// the sketch calls into the shim or accesses a register with side effects (SREG, so also after cli()/sei()).
+// Those are the points where an interrupt can come between two statements of the sketch; plain memory
+// accesses between them take no time unless setAccessCycles() says otherwise.
+//
+// Not modelled: Timer0, PWM and CTC modes, the noise canceler delay of ICP1, and toggling an output by
+// writing its PIN register, which is plain memory here.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace host
+{
+
+typedef void (*Callback_t)(void* aUser);
+
+struct Edge
+{
+  uint64_t Cycle;
+  bool     High;
+};
+
+uint64_t  cycles();                                     // since power on
+uint64_t  microseconds();
+void      advance(uint32_t aMicros);                    // lets time pass
+void      advanceCycles(uint32_t aCycles);
+void      at(uint64_t aCycle, Callback_t aCallback, void* aUser = 0);   // runs aCallback when the clock gets there
+
+void      setAccessCycles(uint8_t aCycles);             // time each shim call or hooked register access takes, default 0
+void      setISRCycles(uint8_t aVector, uint16_t aCycles);   // time a handler takes besides entry and reti, default 0
+uint32_t  isrCount(uint8_t aVector);                    // handler calls since power on
+
+void      setPin(uint8_t aPin, bool aHigh);             // drives an input pin from outside
+void      setPinAt(uint64_t aCycle, uint8_t aPin, bool aHigh);   // the same at a given time, for waveforms
+void      releasePin(uint8_t aPin);                     // stops driving it, it floats or is pulled up
+bool      getPin(uint8_t aPin);                         // level on the pin, whoever drives it
+void      tracePin(uint8_t aPin, bool aEnable = true);  // records the edges on a pin
+std::vector<Edge>& pinEdges(uint8_t aPin);              // recorded so far, the test may clear them
+void      setAnalog(uint8_t aPin, uint16_t aValue);     // A0-A7, 10 bit
+
+void      serialReceive(const void* aData, size_t aLength);   // bytes arriving at RX, back to back at the baud rate
+void      serialReceive(const std::vector<uint8_t>& aData);
+std::vector<uint8_t>& serialSent();                     // bytes that have left TX so far, the test may clear it
+size_t    serialPending();                              // bytes written by the sketch that haven't left yet
+uint32_t  serialOverruns();                             // bytes lost because the RX interrupt came too late
+unsigned long serialBaud();                             // rate of the last Serial.begin()
+
+uint8_t*  eeprom();                                     // E2END+1 bytes, 0xFF after power on like an erased chip
+uint32_t  eepromWrites(uint16_t aAddress);              // physical writes to a cell since power on, for wear checks
+
+} // namespace end
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+namespace host
+{
+
+typedef void (*Vector_t)(void);
+
+// registers an interrupt service routine in the vector table of the shim
+class VectorEntry
+{
+  public:
+    VectorEntry(uint8_t aNumber, Vector_t aHandler);
+};
+
+} // namespace end
+
+// an ISR is a plain function that is entered into the vector table during static initialization
+#define ISR(vector, ...) \
+  extern "C" void vector(void); \
+  static host::VectorEntry vector##_entry(vector##_num, vector); \
+  extern "C" void vector(void)
+#define SIGNAL(vector) ISR(vector)
+
+#define cli() (SREG &= uint8_t(~_BV(SREG_I)))
+#define sei() (SREG |= uint8_t(_BV(SREG_I)))
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+// ATmega328p registers for host builds.
+// Plain registers are just memory. Registers whose access has a side effect on the real chip
+// (SREG, EECR, ADCSRA and the write-one-to-clear flag registers) call into the shim, see Host.cpp.
+
+#include <stdint.h>
+
+namespace host
+{
+
+class Register8
+{
+  public:
+    typedef void    (*WriteHook)(Register8& aRegister, uint8_t aValue);
+    typedef uint8_t (*ReadHook)(Register8& aRegister);
+
+    // no constructor code, so the registers are ready before any static constructor of the sketch runs
+    constexpr Register8(uint8_t aValue, WriteHook aWrite, ReadHook aRead = 0) : m_Value(aValue), m_Write(aWrite), m_Read(aRead) {}
+
+    operator uint8_t()                { return m_Read ? m_Read(*this) : m_Value; }
+    Register8& operator=(uint8_t v)   { m_Write(*this, v); return *this; }
+    Register8& operator|=(uint8_t v)  { return *this = uint8_t(*this) | v; }
+    Register8& operator&=(uint8_t v)  { return *this = uint8_t(*this) & v; }
+    Register8& operator^=(uint8_t v)  { return *this = uint8_t(*this) ^ v; }
+
+    uint8_t           m_Value;        // what the hardware holds, the hooks work on this
+
+  private:
+    Register8(const Register8&);
+    Register8& operator=(const Register8&);
+
+    WriteHook         m_Write;
+    ReadHook          m_Read;
+};
+
+} // namespace end
+
+#define HOST_R8(n)  extern volatile uint8_t  n;
+#define HOST_R16(n) extern volatile uint16_t n;
+#define HOST_HR(n)  extern host::Register8   n;
+
+// status register, cli()/sei() and restoring it may dispatch pending interrupts
+HOST_HR(SREG)
+
+// Timer1, 16 bit
+HOST_R8(TCCR1A) HOST_R8(TCCR1B) HOST_R8(TCCR1C) HOST_R8(TIMSK1) HOST_HR(TIFR1)
+HOST_R16(TCNT1) HOST_R16(OCR1A) HOST_R16(OCR1B) HOST_R16(ICR1)
+
+// Timer2, 8 bit
+HOST_R8(TCCR2A) HOST_R8(TCCR2B) HOST_R8(TIMSK2) HOST_HR(TIFR2)
+HOST_R8(TCNT2) HOST_R8(OCR2A) HOST_R8(OCR2B) HOST_R8(ASSR)
+
+// ports
+HOST_R8(PINB) HOST_R8(PORTB) HOST_R8(DDRB)
+HOST_R8(PINC) HOST_R8(PORTC) HOST_R8(DDRC)
+HOST_R8(PIND) HOST_R8(PORTD) HOST_R8(DDRD)
+
+// pin change and external interrupts
+HOST_R8(PCICR) HOST_HR(PCIFR) HOST_R8(PCMSK0) HOST_R8(PCMSK1) HOST_R8(PCMSK2)
+HOST_R8(EICRA) HOST_R8(EIMSK) HOST_HR(EIFR)
+
+// ADC
+HOST_R8(ADMUX) HOST_HR(ADCSRA) HOST_R8(ADCSRB) HOST_R8(DIDR0)
+HOST_R16(ADC)
+#define ADCW ADC
+
+// EEPROM
+HOST_HR(EECR) HOST_R8(EEDR) HOST_R16(EEAR)
+
+// USART0, Serial is modelled by the shim, these only exist for code that talks to the UART directly
+HOST_R8(UCSR0A) HOST_R8(UCSR0B) HOST_R8(UCSR0C) HOST_R8(UDR0) HOST_R8(UBRR0H) HOST_R8(UBRR0L)
+
+#undef HOST_R8
+#undef HOST_R16
+#undef HOST_HR
+
+// bit positions
+enum
+{
+  // SREG
+  SREG_I = 7,
+
+  // Timer1
+  WGM10 = 0, WGM11 = 1, COM1B0 = 4, COM1B1 = 5, COM1A0 = 6, COM1A1 = 7,
+  CS10 = 0, CS11 = 1, CS12 = 2, WGM12 = 3, WGM13 = 4, ICES1 = 6, ICNC1 = 7,
+  FOC1B = 6, FOC1A = 7,
+  TOIE1 = 0, OCIE1A = 1, OCIE1B = 2, ICIE1 = 5,
+  TOV1 = 0, OCF1A = 1, OCF1B = 2, ICF1 = 5,
+
+  // Timer2
+  WGM20 = 0, WGM21 = 1, COM2B0 = 4, COM2B1 = 5, COM2A0 = 6, COM2A1 = 7,
+  CS20 = 0, CS21 = 1, CS22 = 2, WGM22 = 3,
+  TOIE2 = 0, OCIE2A = 1, OCIE2B = 2,
+  TOV2 = 0, OCF2A = 1, OCF2B = 2,
+
+  // pin change and external interrupts
+  PCIE0 = 0, PCIE1 = 1, PCIE2 = 2, PCIF0 = 0, PCIF1 = 1, PCIF2 = 2,
+  ISC00 = 0, ISC01 = 1, ISC10 = 2, ISC11 = 3, INT0 = 0, INT1 = 1, INTF0 = 0, INTF1 = 1,
+
+  // ADC
+  MUX0 = 0, MUX1 = 1, MUX2 = 2, MUX3 = 3, ADLAR = 5, REFS0 = 6, REFS1 = 7,
+  ADPS0 = 0, ADPS1 = 1, ADPS2 = 2, ADIE = 3, ADIF = 4, ADATE = 5, ADSC = 6, ADEN = 7,
+  ADTS0 = 0, ADTS1 = 1, ADTS2 = 2,
+
+  // EEPROM
+  EERE = 0, EEPE = 1, EEMPE = 2, EERIE = 3,
+
+  // USART0
+  MPCM0 = 0, U2X0 = 1, UPE0 = 2, DOR0 = 3, FE0 = 4, UDRE0 = 5, TXC0 = 6, RXC0 = 7,
+  TXB80 = 0, RXB80 = 1, UCSZ02 = 2, TXEN0 = 3, RXEN0 = 4, UDRIE0 = 5, TXCIE0 = 6, RXCIE0 = 7
+};
+
+// interrupt vectors, the number is also the priority, lowest first
+#define INT0_vect_num          1
+#define INT1_vect_num          2
+#define PCINT0_vect_num        3
+#define PCINT1_vect_num        4
+#define PCINT2_vect_num        5
+#define WDT_vect_num           6
+#define TIMER2_COMPA_vect_num  7
+#define TIMER2_COMPB_vect_num  8
+#define TIMER2_OVF_vect_num    9
+#define TIMER1_CAPT_vect_num  10
+#define TIMER1_COMPA_vect_num 11
+#define TIMER1_COMPB_vect_num 12
+#define TIMER1_OVF_vect_num   13
+#define TIMER0_COMPA_vect_num 14
+#define TIMER0_COMPB_vect_num 15
+#define TIMER0_OVF_vect_num   16
+#define SPI_STC_vect_num      17
+#define USART_RX_vect_num     18
+#define USART_UDRE_vect_num   19
+#define USART_TX_vect_num     20
+#define ADC_vect_num          21
+#define EE_READY_vect_num     22
+#define ANALOG_COMP_vect_num  23
+#define TWI_vect_num          24
+#define SPM_READY_vect_num    25
+#define _VECTORS_SIZE         26
+
+#define E2END   0x3FF
+#define RAMEND  0x8FF
+
+#define _BV(bit)                    (1 << (bit))
+#define bit_is_set(sfr, bit)        (uint8_t(sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit)      (!(uint8_t(sfr) & _BV(bit)))
+#define loop_until_bit_is_set(sfr, bit)   do { } while (bit_is_clear(sfr, bit))
+#define loop_until_bit_is_clear(sfr, bit) do { } while (bit_is_set(sfr, bit))
+
+#endif
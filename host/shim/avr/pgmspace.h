@@ -0,0 +1,36 @@
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+// there is only one address space on the host, flash data is ordinary const data
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <avr/io.h>     // avr-libc pulls the register and _BV definitions in here too
+
+#define PROGMEM
+#define PGM_P            const char*
+#define PSTR(s)          (s)
+
+typedef char     prog_char;
+typedef uint8_t  prog_uint8_t;
+typedef uint16_t prog_uint16_t;
+typedef int16_t  prog_int16_t;
+
+#define pgm_read_byte(p)  (*(const uint8_t*)(p))
+#define pgm_read_word(p)  (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define pgm_read_ptr(p)   (*(void* const*)(p))
+
+#define memcpy_P  memcpy
+#define strlen_P  strlen
+#define strcmp_P  strcmp
+#define strcpy_P  strcpy
+
+// avr-libc prints flash strings with %S, these map it to %s
+int printf_P(const char* aFormat, ...);
+int fprintf_P(FILE* aStream, const char* aFormat, ...);
+int vfprintf_P(FILE* aStream, const char* aFormat, va_list aArgs);
+
+#endif
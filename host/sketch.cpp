@@ -0,0 +1,3 @@
+// The Arduino IDE compiles T5x.ino as C++ with Arduino.h included first, this does the same.
+#include <Arduino.h>
+#include "T5x.ino"
@@ -0,0 +1,81 @@
+// Powers the transmitter up in setup mode on EEPROM written by firmware without records
+// and checks that it converts it in place, sends live sticks soon after, then keeps running without wearing the cells again.
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "RealtimeData.h"
+
+#include "Host.h"
+#include "check.h"
+
+extern t5x::RealtimeData gRealtime;
+extern uint8_t           gResponseStale;
+void requestProfile(uint8_t aProfileId);
+
+static uint32_t totalWrites()
+{
+  uint32_t writes = 0;
+  for (uint16_t a = 0; a <= E2END; ++a) writes += host::eepromWrites(a);
+  return writes;
+}
+
+int main()
+{
+  // legacy layout version 2 at address 1000, the structs themselves are erased
+  host::eeprom()[1000] = 0x02;
+
+  // battery voltage sensor reads 0: setup mode, switches in their default positions
+  host::setAnalog(A7, 0);
+  for (uint8_t pin = 3; pin <= 7; ++pin) host::setPin(pin, HIGH);
+
+  setup();
+  CHECK_EQUAL(9600, host::serialBaud());
+
+  // the migration waits for the EEPROM queue, so every record is in place once setup returns
+  CHECK_EQUAL(0x80, host::eeprom()[1000]);
+  CHECK(host::eepromWrites(0) > 0);
+  CHECK(host::eeprom()[0] != 0xFF);      // record headers hold the record length
+  CHECK(host::eeprom()[192] != 0xFF);
+  CHECK(host::eeprom()[192 + 8 * 88] != 0xFF);
+
+  // the startup beeps play from the scheduler, live sticks go out with the first frames after the migration
+  // (setup() used to wait 4.5s in delay() before the first live frame)
+  while (gRealtime.m_Data.BootTime == 0 && host::microseconds() < 10000000UL)
+  {
+    loop();
+    host::advance(100);
+  }
+  CHECK(gRealtime.m_Data.BootTime > 0 && gRealtime.m_Data.BootTime < 200);
+
+  // nothing changes afterwards, so nothing may be written
+  uint32_t written = totalWrites();
+  host::advance(1000000UL);
+  CHECK_EQUAL(written, totalWrites());
+
+  // loop() keeps running without the PPM interrupt
+  for (int i = 0; i < 100; ++i)
+  {
+    loop();
+    host::advance(1000);
+  }
+  CHECK_EQUAL(written, totalWrites());
+
+  // a profile switch is spread over the frames: load, plan, switch, then the other flight modes' tables
+  requestProfile(1);
+  for (int i = 0; i < 200 && gRealtime.m_Data.ProfileId != 1; ++i)
+  {
+    loop();
+    host::advance(1000);
+  }
+  CHECK_EQUAL(1, gRealtime.m_Data.ProfileId);
+  CHECK_EQUAL(0x3F & ~(1 << gRealtime.m_Data.FlightMode), gResponseStale);
+  for (int i = 0; i < 200; ++i)
+  {
+    loop();
+    host::advance(1000);
+  }
+  CHECK_EQUAL(0, gResponseStale);
+
+  return checkResult();
+}
@@ -0,0 +1,83 @@
+// Bulk export and import of the EEPROM records, with a record that got damaged in EEPROM.
+
+#include <Arduino.h>
+
+#include "BulkTransfer.h"
+#include "EEPROMQueue.h"
+#include "Profile.h"
+#include "util.h"
+
+#include "Host.h"
+#include "check.h"
+
+enum
+{
+  ProfileAddress = T5X_PROFILE_EEPROM_STARTADDR,
+  ProfileSize    = T5X_PROFILE_EEPROM_RESERVED_BYTES
+};
+
+int main()
+{
+  using namespace t5x;
+
+  Serial.begin(9600);
+
+  Profile profile;
+  profile.m_Data = gDefaultProfile;
+  profile.save(0);
+  EEPROMQueue::flush();
+  profile.save(1);
+  EEPROMQueue::flush();
+  host::eeprom()[ProfileAddress + ProfileSize + sizeof(RecordHeader_t) + 3] ^= 0xFF;   // profile 1 fails its CRC now
+  CHECK(checkRecord(ProfileAddress, sizeof(Profile_t)) != 0);
+  CHECK_EQUAL(0, checkRecord(ProfileAddress + ProfileSize, sizeof(Profile_t)));
+
+  // v1 messages to a configurator that hasn't sent a v2 frame: preamble, message id, payload
+  host::serialSent().clear();
+  gBulkTransfer.startExport();
+  while (gBulkTransfer.isExporting()) gBulkTransfer.exportNext();
+  Serial.flush();
+
+  const std::vector<uint8_t>& sent = host::serialSent();
+  std::vector<uint8_t> records[T5X_BULK_SLOTS];
+  size_t pos = 0;
+  for (uint8_t i = 0; i < T5X_BULK_SLOTS && pos + 3 + 1 + sizeof(RecordHeader_t) <= sent.size(); ++i)
+  {
+    CHECK_EQUAL(T5X_MSG_BULK_RECORD_INFO_MSGID, sent[pos + 2]);
+    size_t length = 1 + sizeof(RecordHeader_t) + sent[pos + 4];
+    CHECK_EQUAL(i, sent[pos + 3]);
+    records[i].assign(sent.begin() + pos + 3, sent.begin() + pos + 3 + length);
+    pos += 3 + length;
+  }
+  CHECK_EQUAL(pos + 6, sent.size());
+  if (pos + 6 == sent.size())
+  {
+    CHECK_EQUAL(T5X_MSG_BULK_DONE_INFO_MSGID, sent[pos + 2]);
+    CHECK_EQUAL(T5X_BULK_SLOTS, sent[pos + 3]);
+  }
+
+  // the intact record goes out as stored, the damaged one and the never written ones as empty slots
+  CHECK_EQUAL(1 + sizeof(RecordHeader_t) + sizeof(Profile_t), records[0].size());
+  CHECK_EQUAL(1 + sizeof(RecordHeader_t), records[1].size());
+  CHECK_EQUAL(1 + sizeof(RecordHeader_t), records[T5X_BULK_SLOT_DEVICE].size());
+  for (uint8_t i = 1; i < 1 + sizeof(RecordHeader_t) && i < records[1].size(); ++i) CHECK_EQUAL(0, records[1][i]);
+
+  // importing the empty slot header empties the slot, the intact record is written as it came
+  for (uint16_t a = ProfileAddress; a < ProfileAddress + 2 * ProfileSize; ++a) host::eeprom()[a] = 0xFF;
+  gBulkTransfer.startImport();
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < 2; ++i)
+  {
+    CHECK_EQUAL(0, gBulkTransfer.importRecord(&records[i][0], records[i].size()));
+    crc = crc16(crc, &records[i][0], records[i].size());
+  }
+  CHECK(checkRecord(ProfileAddress, sizeof(Profile_t)) != 0);
+  CHECK_EQUAL(0, checkRecord(ProfileAddress + ProfileSize, sizeof(Profile_t)));
+  CHECK_EQUAL(0, host::eeprom()[ProfileAddress + ProfileSize + 1]);   // Version 0, not an erased header
+  CHECK(gBulkTransfer.endImport(2, crc));
+
+  // the end message closes the transaction, a retry has to send every record again
+  CHECK(!gBulkTransfer.endImport(2, crc));
+
+  return checkResult();
+}
@@ -0,0 +1,24 @@
+#ifndef HOST_TESTS_CHECK_H
+#define HOST_TESTS_CHECK_H
+
+// minimal checks for the host tests, each test is a program that returns non-zero if a check failed
+
+#include <stdio.h>
+
+static int g_CheckFailures = 0;
+
+#define CHECK(x) \
+  do { if (!(x)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); ++g_CheckFailures; } } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+  do { long long e_ = (long long)(expected), a_ = (long long)(actual); \
+       if (e_ != a_) { printf("%s:%d: CHECK_EQUAL(%s, %s) failed: %lld != %lld\n", \
+                              __FILE__, __LINE__, #expected, #actual, e_, a_); ++g_CheckFailures; } } while (0)
+
+static int checkResult()
+{
+  if (g_CheckFailures != 0) printf("%d check(s) failed\n", g_CheckFailures);
+  return g_CheckFailures != 0;
+}
+
+#endif
@@ -0,0 +1,60 @@
+// The background EEPROM queue only writes the cells whose value changes.
+
+#include <Arduino.h>
+
+#include "EEPROMQueue.h"
+
+#include "Host.h"
+#include "check.h"
+
+int main()
+{
+  using t5x::EEPROMQueue;
+
+  uint8_t data[40];
+  for (uint8_t i = 0; i < sizeof(data); ++i) data[i] = i;
+
+  // erased cells, everything is written once
+  EEPROMQueue::write(100, data, sizeof(data));
+  EEPROMQueue::flush();
+  CHECK_EQUAL(sizeof(data), EEPROMQueue::getWritten());
+  CHECK_EQUAL(0, EEPROMQueue::getSkipped());
+  for (uint8_t i = 0; i < sizeof(data); ++i)
+  {
+    CHECK_EQUAL(i, host::eeprom()[100 + i]);
+    CHECK_EQUAL(1, EEPROMQueue::getWrites(100 + i));
+  }
+
+  // saving the same data again is skipped cell by cell and doesn't count as wear,
+  // a few cells per interrupt so none of them runs long
+  uint32_t interrupts = host::isrCount(EE_READY_vect_num);
+  EEPROMQueue::write(100, data, sizeof(data));
+  EEPROMQueue::flush();
+  CHECK(host::isrCount(EE_READY_vect_num) - interrupts >= sizeof(data) / T5X_EEPROM_SKIP_PER_ISR);
+  CHECK_EQUAL(0, EEPROMQueue::getWritten());
+  CHECK_EQUAL(sizeof(data), EEPROMQueue::getSkipped());
+  for (uint8_t i = 0; i < sizeof(data); ++i) CHECK_EQUAL(1, EEPROMQueue::getWrites(100 + i));
+
+  // one changed byte in the middle of a block is the only cell written
+  data[17] = 0xA5;
+  EEPROMQueue::write(100, data, sizeof(data));
+  EEPROMQueue::flush();
+  CHECK_EQUAL(1, EEPROMQueue::getWritten());
+  CHECK_EQUAL(sizeof(data) - 1, EEPROMQueue::getSkipped());
+  CHECK_EQUAL(2, EEPROMQueue::getWrites(117));
+  CHECK_EQUAL(1, EEPROMQueue::getWrites(116));
+  CHECK_EQUAL(1, EEPROMQueue::getWrites(118));
+
+  // the counters agree with what the chip saw, and nothing else was touched
+  uint32_t queue = 0;
+  uint32_t chip  = 0;
+  for (uint16_t a = 0; a <= E2END; ++a)
+  {
+    queue += EEPROMQueue::getWrites(a);
+    chip  += host::eepromWrites(a);
+  }
+  CHECK_EQUAL(sizeof(data) + 1, queue);
+  CHECK_EQUAL(queue, chip);
+
+  return checkResult();
+}
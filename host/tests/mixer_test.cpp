@@ -0,0 +1,94 @@
+// The library's stick to pulse path on the host: an analog pin through expo, dual rates and a channel.
+
+#include <Arduino.h>
+
+#include <set>
+
+#include <ADCSampler.h>
+#include <AIPin.h>
+#include <Channel.h>
+#include <DualRates.h>
+#include <Expo.h>
+#include <InputToOutputPipe.h>
+#include <input.h>
+#include <outputchannel.h>
+#include <util.h>
+
+#include "Host.h"
+#include "check.h"
+
+static uint16_t pulse(rc::AIPin& aPin, const rc::Expo& aExpo, const rc::DualRates& aRates,
+                      rc::InputToOutputPipe& aPipe, rc::Channel& aChannel, uint16_t aAnalog)
+{
+  host::setAnalog(aPin.getPin(), aAnalog);
+  aPin.read();
+  aExpo.apply();
+  aRates.apply();
+  aPipe.apply();
+  return aChannel.apply();
+}
+
+
+// distinct stick values over half the travel, with the background sampler at the given oversampling
+static size_t steps(rc::AIPin& aPin, uint8_t aOversampling)
+{
+  rc::ADCSampler::start(aOversampling, 0x01);
+  std::set<int16_t> values;
+  for (uint16_t analog = 511; analog <= 1023; ++analog)
+  {
+    host::setAnalog(aPin.getPin(), analog);
+    host::advance(20000);   // two rounds of 64 conversions, the tables are swapped after each
+    values.insert(aPin.read());
+  }
+  rc::ADCSampler::stop();
+  return values.size();
+}
+
+
+int main()
+{
+  rc::setCenter(1500);
+  rc::setTravel(700);
+
+  rc::AIPin             pin(A0, rc::Input_AIL);
+  rc::Expo              expo(0, rc::Input_AIL);
+  rc::DualRates         rates(100, rc::Input_AIL);
+  rc::InputToOutputPipe pipe(rc::Input_AIL, rc::Output_AIL1);
+  rc::Channel           channel(rc::Output_AIL1, rc::OutputChannel_1);
+
+  // end points of 140% give the full travel, 100% only reaches 100/140 of it
+  channel.setEndPointMin(140);
+  channel.setEndPointMax(140);
+
+  // full travel, and centered within a microsecond
+  CHECK_EQUAL(800,  pulse(pin, expo, rates, pipe, channel, 0));
+  CHECK_EQUAL(2200, pulse(pin, expo, rates, pipe, channel, 1023));
+  uint16_t center = pulse(pin, expo, rates, pipe, channel, 511);
+  CHECK(center >= 1499 && center <= 1501);
+  CHECK_EQUAL(center, rc::getOutputChannel(rc::OutputChannel_1));
+
+  // half rates halve the travel
+  rates.set(50);
+  CHECK_EQUAL(1150, pulse(pin, expo, rates, pipe, channel, 0));
+
+  // expo leaves the end points alone and softens the middle
+  rates.set(100);
+  expo.set(50);
+  CHECK_EQUAL(2200, pulse(pin, expo, rates, pipe, channel, 1023));
+  CHECK(pulse(pin, expo, rates, pipe, channel, 767) < 1850);
+
+  // reversed channel
+  channel.setReverse(true);
+  expo.set(0);
+  CHECK_EQUAL(2200, pulse(pin, expo, rates, pipe, channel, 0));
+
+  // oversampling adds resolution, the normalization mustn't throw it away again
+  size_t plain = steps(pin, 0);
+  CHECK(plain >= 250);
+  for (uint8_t res = 1; res <= 3; ++res)
+  {
+    CHECK(steps(pin, res) >= plain);
+  }
+
+  return checkResult();
+}
@@ -0,0 +1,140 @@
+// The configurator protocol: v1 messages, v2 frames with ACK/NAK and repeats, and answering in the protocol used last.
+
+#include <Arduino.h>
+
+#include "Protocol.h"
+#include "util.h"
+
+#include "Host.h"
+#include "check.h"
+
+using t5x::gProtocol;
+
+// feeds bytes to the parser, returns how many complete messages came out
+static uint8_t feed(const std::vector<uint8_t>& aBytes)
+{
+  uint8_t messages = 0;
+  for (size_t i = 0; i < aBytes.size(); ++i) messages += gProtocol.parse(aBytes[i]);
+  return messages;
+}
+
+
+static std::vector<uint8_t> frame(uint8_t aSeq, uint8_t aMsgId, const std::vector<uint8_t>& aPayload, boolean aDamaged = false)
+{
+  std::vector<uint8_t> f;
+  f.push_back(T5X_MSG_CONFIGURATOR_TO_TX_PREAMBLE1);
+  f.push_back(T5X_MSG_CONFIGURATOR_TO_TX_FRAMED_PREAMBLE2);
+  f.push_back(aSeq);
+  f.push_back(aMsgId);
+  f.push_back(aPayload.size());
+  f.insert(f.end(), aPayload.begin(), aPayload.end());
+  uint16_t crc = t5x::crc16(0xFFFF, &f[2], f.size() - 2);
+  if (aDamaged) crc ^= 1;
+  f.push_back(uint8_t(crc));
+  f.push_back(uint8_t(crc >> 8));
+  return f;
+}
+
+
+static std::vector<uint8_t> v1(uint8_t aMsgId, uint8_t aByte)
+{
+  std::vector<uint8_t> m;
+  m.push_back(T5X_MSG_CONFIGURATOR_TO_TX_PREAMBLE1);
+  m.push_back(T5X_MSG_CONFIGURATOR_TO_TX_PREAMBLE2);
+  m.push_back(aMsgId);
+  m.push_back(aByte);
+  return m;
+}
+
+
+// what the TX sent in answer to the last message
+static std::vector<uint8_t> sent()
+{
+  Serial.flush();
+  std::vector<uint8_t> s = host::serialSent();
+  host::serialSent().clear();
+  return s;
+}
+
+
+int main()
+{
+  Serial.begin(9600);
+  const uint8_t info[2] = {0x12, 0x34};
+
+  // v1 request, v1 answer without sequence number or CRC; ACK and NAK are v2 only
+  CHECK_EQUAL(1, feed(v1(T5X_MSG_PROFILE_DATA_REQ_MSGID, 0)));
+  CHECK_EQUAL(T5X_MSG_PROFILE_DATA_REQ_MSGID, gProtocol.msgId());
+  CHECK(!gProtocol.isRepeat());
+  gProtocol.ack();
+  gProtocol.send(T5X_MSG_PROFILE_DATA_INFO_MSGID, info, sizeof(info));
+  std::vector<uint8_t> s = sent();
+  CHECK_EQUAL(5, s.size());
+  if (s.size() == 5)
+  {
+    CHECK_EQUAL(T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE2, s[1]);
+    CHECK_EQUAL(T5X_MSG_PROFILE_DATA_INFO_MSGID, s[2]);
+    CHECK_EQUAL(0x34, s[4]);
+  }
+
+  // v2 frame, acknowledged with its sequence number in a v2 frame of its own
+  std::vector<uint8_t> select(1, 3);
+  CHECK_EQUAL(1, feed(frame(7, T5X_MSG_PROFILE_SELECT_MSGID, select)));
+  CHECK_EQUAL(T5X_MSG_PROFILE_SELECT_MSGID, gProtocol.msgId());
+  CHECK_EQUAL(1, gProtocol.length());
+  CHECK_EQUAL(3, gProtocol.payload()[0]);
+  CHECK(!gProtocol.isRepeat());
+  gProtocol.ack();
+  s = sent();
+  CHECK_EQUAL(8, s.size());
+  if (s.size() == 8)
+  {
+    CHECK_EQUAL(T5X_MSG_TX_TO_CONFIGURATOR_FRAMED_PREAMBLE2, s[1]);
+    CHECK_EQUAL(T5X_MSG_ACK_INFO_MSGID, s[3]);
+    CHECK_EQUAL(1, s[4]);
+    CHECK_EQUAL(7, s[5]);
+    uint16_t crc = t5x::crc16(0xFFFF, &s[2], 4);
+    CHECK_EQUAL(crc, s[6] | (s[7] << 8));
+  }
+
+  // the ACK got lost, the same frame again is recognized as a repeat
+  CHECK_EQUAL(1, feed(frame(7, T5X_MSG_PROFILE_SELECT_MSGID, select)));
+  CHECK(gProtocol.isRepeat());
+  gProtocol.ack();
+  sent();
+  CHECK_EQUAL(1, feed(frame(8, T5X_MSG_PROFILE_SELECT_MSGID, select)));
+  CHECK(!gProtocol.isRepeat());
+  gProtocol.ack();
+  sent();
+
+  // a damaged frame is not handed on, it is NAKed with the reason
+  CHECK_EQUAL(0, feed(frame(9, T5X_MSG_PROFILE_SELECT_MSGID, select, true)));
+  s = sent();
+  CHECK_EQUAL(9, s.size());
+  if (s.size() == 9)
+  {
+    CHECK_EQUAL(T5X_MSG_NAK_INFO_MSGID, s[3]);
+    CHECK_EQUAL(9, s[5]);
+    CHECK_EQUAL(T5X_NAK_CRC, s[6]);
+  }
+
+  // a frame longer than any message is NAKed as soon as its length is known
+  std::vector<uint8_t> tooLong = frame(10, T5X_MSG_PROFILE_SELECT_MSGID, std::vector<uint8_t>(T5X_PROTOCOL_MAX_PAYLOAD + 1));
+  tooLong.resize(5);
+  CHECK_EQUAL(0, feed(tooLong));
+  s = sent();
+  CHECK(s.size() == 9 && s[6] == T5X_NAK_LENGTH);
+
+  // back to v1: the answer is v1 again
+  CHECK_EQUAL(1, feed(v1(T5X_MSG_PROFILE_DATA_REQ_MSGID, 0)));
+  gProtocol.send(T5X_MSG_PROFILE_DATA_INFO_MSGID, info, sizeof(info));
+  s = sent();
+  CHECK(s.size() == 5 && s[1] == T5X_MSG_TX_TO_CONFIGURATOR_PREAMBLE2);
+
+  // sharing the line with telemetry only v2 frames are taken
+  gProtocol.setFramedOnly(true);
+  CHECK_EQUAL(0, feed(v1(T5X_MSG_PROFILE_DATA_REQ_MSGID, 0)));
+  CHECK_EQUAL(1, feed(frame(11, T5X_MSG_PROFILE_SELECT_MSGID, select)));
+
+  return checkResult();
+}
@@ -0,0 +1,51 @@
+// The cooperative scheduler with frames longer than the periods of its tasks.
+
+#include <Arduino.h>
+
+#include "Scheduler.h"
+
+#include "check.h"
+
+static uint16_t s_Runs[4];
+
+static void taskEvery()  { ++s_Runs[0]; }
+static void taskFast()   { ++s_Runs[1]; }
+static void taskMedium() { ++s_Runs[2]; }
+static void taskSlow()   { ++s_Runs[3]; }
+
+static const t5x::Task_t s_Tasks[4] =
+{
+  { taskEvery,     0,    0},
+  { taskFast,     20,   40},
+  { taskMedium,   20,   40},
+  { taskSlow,   1000,  100},
+};
+
+int main()
+{
+  t5x::Scheduler scheduler(s_Tasks, 4);
+  for (uint8_t i = 0; i < 4; ++i) scheduler.enable(i, true);
+
+  // short frames: one periodic task per pass keeps up, the others wait their turn within their deadline
+  unsigned long now = 0;
+  for (uint16_t pass = 0; pass < 1000; ++pass) scheduler.run(now += 8);
+  CHECK_EQUAL(1000, s_Runs[0]);
+  CHECK(s_Runs[1] >= 390);
+  CHECK(s_Runs[2] >= 390);
+  CHECK(s_Runs[3] >= 7);
+  for (uint8_t i = 1; i < 4; ++i) CHECK_EQUAL(0, scheduler.misses(i));
+
+  // 30ms frames, like 12 channels at full travel: the fast task is due on every pass,
+  // the others still run once they reach their deadline and count the miss
+  for (uint8_t i = 0; i < 4; ++i) s_Runs[i] = 0;
+  for (uint16_t pass = 0; pass < 1000; ++pass) scheduler.run(now += 30);
+  CHECK_EQUAL(1000, s_Runs[0]);
+  CHECK(s_Runs[1] >= 990);
+  CHECK(s_Runs[2] >= 330);
+  CHECK(s_Runs[3] >= 29);
+  CHECK_EQUAL(0, scheduler.misses(1));
+  CHECK(scheduler.misses(2) > 0);
+  CHECK(scheduler.misses(3) > 0);
+
+  return checkResult();
+}
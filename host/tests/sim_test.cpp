@@ -0,0 +1,398 @@
+// The interrupt driven parts of the library on the simulated timers, pins and serial line.
+
+#include <Arduino.h>
+
+#include <PPMIn.h>
+#include <PPMOut.h>
+#include <Timer1.h>
+#include <Timer2.h>
+#include <inputchannel.h>
+#include <rc_pcint.h>
+#include <outputchannel.h>
+
+#include "Host.h"
+#include "check.h"
+
+enum
+{
+  CyclesPerMicro = F_CPU / 1000000UL
+};
+
+
+// a PPM signal with low pulses from outside, idle high, slots of aChannels microseconds followed by a sync gap
+static uint64_t schedulePPM(uint8_t aPin, uint64_t aStart, const uint16_t* aChannels, uint8_t aCount,
+                            uint8_t aFrames, uint16_t aFrameLength)
+{
+  uint64_t t = aStart;
+  for (uint8_t f = 0; f < aFrames; ++f)
+  {
+    uint64_t frameStart = t;
+    for (uint8_t c = 0; c <= aCount; ++c)
+    {
+      host::setPinAt(t, aPin, false);
+      host::setPinAt(t + 300 * CyclesPerMicro, aPin, true);
+      t += (c < aCount ? aChannels[c] : 0) * uint64_t(CyclesPerMicro);
+    }
+    t = frameStart + aFrameLength * uint64_t(CyclesPerMicro);
+  }
+  return t;
+}
+
+
+// slot lengths between rising edges, in microseconds
+static std::vector<uint32_t> slots(const std::vector<host::Edge>& aEdges)
+{
+  std::vector<uint32_t> result;
+  uint64_t last = 0;
+  for (size_t i = 0; i < aEdges.size(); ++i)
+  {
+    if (!aEdges[i].High) continue;
+    if (last != 0) result.push_back((aEdges[i].Cycle - last) / CyclesPerMicro);
+    last = aEdges[i].Cycle;
+  }
+  return result;
+}
+
+
+static void testPPMOut()
+{
+  static const uint16_t values[4] = {1000, 1250, 1500, 2000};
+  for (uint8_t i = 0; i < 4; ++i) rc::setOutputChannel(rc::OutputChannel(rc::OutputChannel_1 + i), values[i]);
+
+  rc::PPMOut out(4);
+  out.setPulseLength(300);
+  out.setPauseLength(20000);
+  host::tracePin(9);
+  out.start(9);
+  host::advance(100000UL);
+
+  // OC1A toggles the pin in hardware, so the slots come out exact to the microsecond
+  std::vector<uint32_t> s = slots(host::pinEdges(9));
+  CHECK(s.size() >= 15);
+  size_t sync = 0;
+  while (sync < s.size() && s[sync] < 3000) ++sync;
+  CHECK(sync + 5 < s.size());
+  if (sync + 5 < s.size())
+  {
+    for (uint8_t i = 0; i < 4; ++i) CHECK_EQUAL(values[i], s[sync + 1 + i]);
+    CHECK_EQUAL(20000 - 1000 - 1250 - 1500 - 2000, s[sync + 5]);
+  }
+
+  // the compare interrupt runs twice per slot, pulse and pause
+  CHECK(host::isrCount(TIMER1_COMPA_vect_num) >= 2 * 5 * 4);
+
+  rc::Timer1::setCompareMatch(false, true);
+  rc::Timer1::setToggle(false, true);
+  host::tracePin(9, false);
+}
+
+
+static void testPPMOutLongFrame()
+{
+  // 12 channels at full travel don't fit 22.5ms with a 4ms sync gap, the frame stretches rather than the gap shrinking
+  for (uint8_t i = 0; i < 12; ++i) rc::setOutputChannel(rc::OutputChannel(rc::OutputChannel_1 + i), 2200);
+
+  rc::PPMOut out(12);
+  out.setPulseLength(400);
+  out.setAdaptiveFrame(4000, 10000);
+  host::pinEdges(9).clear();
+  host::tracePin(9);
+  out.start(9);
+  host::advance(100000UL);
+
+  std::vector<uint32_t> s = slots(host::pinEdges(9));
+  size_t sync = 0;
+  while (sync < s.size() && s[sync] < 3000) ++sync;
+  CHECK(sync + 13 < s.size());
+  if (sync + 13 < s.size())
+  {
+    for (uint8_t i = 0; i < 12; ++i) CHECK_EQUAL(2200, s[sync + 1 + i]);
+    CHECK_EQUAL(4000, s[sync + 13]);
+  }
+
+  rc::Timer1::setCompareMatch(false, true);
+  rc::Timer1::setToggle(false, true);
+  host::tracePin(9, false);
+}
+
+
+static void testPPMOutHandoff()
+{
+  // update() at any point in the frame, every frame has to carry the values of exactly one update()
+  static const uint16_t patterns[2][4] = {{1000, 1200, 1400, 1600}, {1600, 1400, 1200, 1000}};
+  for (uint8_t i = 0; i < 4; ++i) rc::setOutputChannel(rc::OutputChannel(rc::OutputChannel_1 + i), patterns[0][i]);
+
+  rc::PPMOut out(4);
+  out.setPulseLength(300);
+  out.setPauseLength(20000);
+  host::pinEdges(9).clear();
+  host::tracePin(9);
+  out.start(9);
+  host::advance(25000UL);
+
+  uint8_t first    = out.getFrameSequence();
+  uint8_t last     = first;
+  uint8_t advanced = 0;
+  for (uint8_t k = 0; k < 60; ++k)
+  {
+    const uint16_t* p = patterns[k & 1];
+    for (uint8_t i = 0; i < 4; ++i) rc::setOutputChannel(rc::OutputChannel(rc::OutputChannel_1 + i), p[i]);
+    out.update();
+    host::advance(500 + (k * 7919UL) % 25000);
+    if (out.getFrameSequence() != last) ++advanced;
+    last = out.getFrameSequence();
+  }
+  host::advance(50000UL);
+  CHECK_EQUAL(uint8_t(first + 60), out.getFrameSequence());
+  CHECK(advanced >= 30);
+
+  std::vector<uint32_t> s = slots(host::pinEdges(9));
+  size_t frames  = 0;
+  size_t matched = 0;
+  bool   seen[2] = {false, false};
+  for (size_t sync = 0; sync + 5 < s.size(); ++sync)
+  {
+    if (s[sync] < 3000) continue;
+    ++frames;
+    for (uint8_t n = 0; n < 2; ++n)
+    {
+      bool same = true;
+      for (uint8_t i = 0; i < 4; ++i) same = same && s[sync + 1 + i] == patterns[n][i];
+      if (same)
+      {
+        ++matched;
+        seen[n] = true;
+      }
+    }
+  }
+  CHECK(frames >= 35);
+  CHECK_EQUAL(frames, matched);
+  CHECK(seen[0] && seen[1]);
+
+  rc::Timer1::setCompareMatch(false, true);
+  rc::Timer1::setToggle(false, true);
+  host::tracePin(9, false);
+}
+
+
+static void testPPMIn()
+{
+  static const uint16_t values[6] = {1100, 1200, 1300, 1400, 1500, 1900};
+
+  rc::PPMIn in;
+  in.setPin(8);
+  in.start(false);
+  host::setPin(8, true);
+
+  uint64_t end = schedulePPM(8, host::cycles() + 1000, values, 6, 5, 22500);
+  host::advanceCycles(end - host::cycles());
+  CHECK(in.isStable());
+  CHECK_EQUAL(6, in.getChannels());
+  CHECK(in.update());
+  for (uint8_t i = 0; i < 6; ++i)
+  {
+    uint16_t v = rc::getInputChannel(rc::InputChannel(rc::InputChannel_1 + i));
+    CHECK(v >= values[i] - 1 && v <= values[i] + 1);
+  }
+
+  // a second of silence and the signal is gone
+  host::advance(1000000UL);
+  in.update();
+  CHECK(in.isLost());
+  in.stop();
+}
+
+
+static void busyTick()
+{
+  OCR2A += 37;
+}
+
+
+static void testPPMInJitter()
+{
+  // the same signal on pin 8 read through the pin change interrupt and through ICP1, while a Timer2 handler
+  // of 40us runs every 148us, out of step with the PPM frame
+  static const uint16_t values[8] = {1000, 1100, 1250, 1400, 1500, 1650, 1800, 2000};
+  enum { Frames = 200 };
+
+  rc::Timer2::init();
+  OCR2A = 37;
+  rc::Timer2::setCompareMatch(true, true, busyTick);
+  host::setISRCycles(TIMER2_COMPA_vect_num, 40 * CyclesPerMicro);
+  rc::Timer2::start(rc::Timer2::Prescaler_64);
+
+  rc::PPMIn pcint;
+  pcint.setPin(8);
+  pcint.start(false);
+  rc::PPMIn capture;
+  capture.startCapture(false);
+  host::setPin(8, true);
+
+  uint16_t pcintMin[8], pcintMax[8], captureMin[8], captureMax[8];
+  for (uint8_t i = 0; i < 8; ++i)
+  {
+    pcintMin[i]   = captureMin[i] = 0xFFFF;
+    pcintMax[i]   = captureMax[i] = 0;
+  }
+
+  uint8_t frames = 0;
+  for (uint16_t f = 0; f < Frames; ++f)
+  {
+    uint64_t end = schedulePPM(8, host::cycles() + 1000, values, 8, 1, 22500);
+    host::advanceCycles(end - host::cycles());
+
+    // both write the same input channels, read each right after its update
+    bool fresh = pcint.update();
+    for (uint8_t i = 0; fresh && i < 8; ++i)
+    {
+      uint16_t v = rc::getInputChannel(rc::InputChannel(rc::InputChannel_1 + i));
+      pcintMin[i] = v < pcintMin[i] ? v : pcintMin[i];
+      pcintMax[i] = v > pcintMax[i] ? v : pcintMax[i];
+    }
+    fresh = capture.update() && fresh;
+    for (uint8_t i = 0; fresh && i < 8; ++i)
+    {
+      uint16_t v = rc::getInputChannel(rc::InputChannel(rc::InputChannel_1 + i));
+      captureMin[i] = v < captureMin[i] ? v : captureMin[i];
+      captureMax[i] = v > captureMax[i] ? v : captureMax[i];
+    }
+    frames += fresh;
+  }
+  CHECK(frames >= Frames - 3);
+
+  // ICP1 latches the timer at the edge, the channels come out exact whatever the other interrupts do;
+  // the pin change interrupt reads the timer when it gets to run, up to a whole Timer2 handler late
+  uint16_t pcintSpread = 0;
+  for (uint8_t i = 0; i < 8; ++i)
+  {
+    CHECK_EQUAL(values[i], captureMin[i]);
+    CHECK_EQUAL(values[i], captureMax[i]);
+    uint16_t spread = pcintMax[i] - pcintMin[i];
+    pcintSpread = spread > pcintSpread ? spread : pcintSpread;
+  }
+  CHECK(pcintSpread >= 40);
+  CHECK(pcintSpread <= 90);
+
+  capture.stop();
+  pcint.stop();
+  rc::Timer2::stop();
+  host::setISRCycles(TIMER2_COMPA_vect_num, 0);
+}
+
+
+static uint16_t s_Timer2Calls = 0;
+
+static void timer2Compare()
+{
+  OCR2A += 156;
+  ++s_Timer2Calls;
+}
+
+
+static void testTimer2()
+{
+  rc::Timer2::init();
+  OCR2A = 156;
+  rc::Timer2::setCompareMatch(true, true, timer2Compare);
+  rc::Timer2::start(rc::Timer2::Prescaler_1024);
+
+  // 16MHz / 1024 / 156 is 100.16Hz, the buzzer's 10ms tick
+  host::advance(10000000UL);
+  CHECK(s_Timer2Calls >= 1001 && s_Timer2Calls <= 1002);
+  rc::Timer2::stop();
+}
+
+
+static void testSerial()
+{
+  Serial.begin(9600);
+  uint8_t data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+  // ten bits per byte at 9600 baud take 1.04ms each
+  host::serialReceive(data, sizeof(data));
+  host::advance(5000);
+  CHECK_EQUAL(4, Serial.available());
+  host::advance(6000);
+  CHECK_EQUAL(10, Serial.available());
+  for (uint8_t i = 0; i < 10; ++i) CHECK_EQUAL(i, Serial.read());
+
+  // with interrupts off longer than the USART can buffer, bytes are lost
+  cli();
+  host::serialReceive(data, sizeof(data));
+  host::advance(11000);
+  sei();
+  CHECK_EQUAL(2, Serial.available());
+  CHECK_EQUAL(8, host::serialOverruns());
+  while (Serial.read() >= 0) ;
+
+  // sending is paced by the line as well, the core buffers what doesn't fit
+  host::serialSent().clear();
+  Serial.write(data, sizeof(data));
+  CHECK_EQUAL(0, host::serialSent().size());
+  CHECK_EQUAL(10, host::serialPending());
+  host::advance(5000);
+  CHECK_EQUAL(4, host::serialSent().size());
+  Serial.flush();
+  CHECK_EQUAL(10, host::serialSent().size());
+  CHECK(host::serialSent()[9] == 9);
+}
+
+
+static uint64_t s_TimerEntered = 0;
+static uint64_t s_EdgeSeen     = 0;
+
+static void busyTimer()
+{
+  s_TimerEntered = host::cycles();
+}
+
+
+static void edgeSeen(uint8_t, bool, void*)
+{
+  s_EdgeSeen = host::cycles();
+}
+
+
+static void testLatency()
+{
+  rc::pcint::enable(4, edgeSeen);
+  host::setPin(4, false);
+
+  // without other interrupts a pin change is handled right away
+  uint64_t start = host::cycles();
+  host::setPinAt(start + 200, 4, true);
+  host::advance(100);
+  CHECK(s_EdgeSeen >= start + 200 && s_EdgeSeen < start + 200 + 50);
+
+  // during a long handler it has to wait until that one returns
+  rc::Timer2::init();
+  OCR2A = 10;
+  rc::Timer2::setCompareMatch(true, true, busyTimer);
+  host::setISRCycles(TIMER2_COMPA_vect_num, 800);
+
+  start = host::cycles();
+  rc::Timer2::start(rc::Timer2::Prescaler_8);     // compare match within 80 cycles, the prescaler keeps its phase
+  host::setPinAt(start + 200, 4, false);
+  host::advance(100);
+  CHECK(s_TimerEntered > start && s_TimerEntered < start + 200);
+  CHECK(s_EdgeSeen > s_TimerEntered + 800);
+
+  rc::Timer2::stop();
+  rc::pcint::disable(4);
+  host::setISRCycles(TIMER2_COMPA_vect_num, 0);
+}
+
+
+int main()
+{
+  testPPMOut();
+  testPPMOutLongFrame();
+  testPPMOutHandoff();
+  testPPMIn();
+  testPPMInJitter();
+  testTimer2();
+  testSerial();
+  testLatency();
+  return checkResult();
+}
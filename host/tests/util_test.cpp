@@ -0,0 +1,52 @@
+// The reciprocal divisions of the mixer path against plain integer division, for every input they accept.
+
+#include <Arduino.h>
+
+#include <util.h>
+
+#include "check.h"
+
+int main()
+{
+  // div100 over its whole documented range, and where that range ends
+  uint32_t wrong = 0;
+  for (uint32_t v = 0; v <= 43698; ++v) wrong += rc::div100(v) != v / 100;
+  CHECK_EQUAL(0, wrong);
+  CHECK(rc::div100(43699) != 43699 / 100);
+
+  // div140 over all 16 bit values
+  wrong = 0;
+  for (uint32_t v = 0; v <= 0xFFFF; ++v) wrong += rc::div140(v) != v / 140;
+  CHECK_EQUAL(0, wrong);
+
+  // mix, every value of the 140% range with every amount, truncated towards zero like the division was
+  wrong = 0;
+  for (int16_t value = -358; value <= 358; ++value)
+  {
+    for (int8_t amount = -100; amount <= 100; ++amount) wrong += rc::mix(value, amount) != value * amount / 100;
+  }
+  CHECK_EQUAL(0, wrong);
+
+  // microsToNormalized against (delta * 64) / (travel / 4) for every travel and every position within it:
+  // exact up to a travel of 851, at most 1 higher from 852 to 1023
+  rc::setCenter(1500);
+  uint16_t firstInexact = 0;
+  uint32_t outOfBounds  = 0;
+  for (uint16_t travel = 1; travel <= 1023; ++travel)
+  {
+    rc::setTravel(travel);
+    uint16_t divisor = travel >= 4 ? travel >> 2 : 1;
+    for (uint16_t delta = 0; delta < travel; ++delta)
+    {
+      int16_t expected = static_cast<int16_t>((delta << 6) / divisor);
+      int16_t up   = rc::microsToNormalized(1500 + delta);
+      int16_t down = rc::microsToNormalized(1500 - delta);
+      if (up != expected && firstInexact == 0) firstInexact = travel;
+      outOfBounds += up < expected || up > expected + 1 || down != -up;
+    }
+  }
+  CHECK_EQUAL(852, firstInexact);
+  CHECK_EQUAL(0, outOfBounds);
+
+  return checkResult();
+}
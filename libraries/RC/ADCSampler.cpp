@@ -0,0 +1,178 @@
+/* ---------------------------------------------------------------------------
+** This software is in the public domain, furnished "as is", without technical
+** support, and with no warranty, express or implied, as to its usefulness for
+** any purpose.
+**
+** ADCSampler.cpp
+** Interrupt driven background sampling of the analog inputs
+**
+** Project: ArduinoRCLib
+** Website: http://sourceforge.net/p/arduinorclib/
+** -------------------------------------------------------------------------*/
+
+#include <Arduino.h>
+
+#include <ADCSampler.h>
+#include <rc_debug_lib.h>
+
+
+// Static variables
+static volatile uint16_t s_values[2][8] = { { 0 } }; // result tables, one is read while the other one is filled
+static volatile uint8_t  s_front   = 0;    // index of the table which is read from
+static volatile bool     s_running = false;
+static uint8_t           s_mask    = 0;    // inputs to sample
+static uint8_t           s_bits    = 0;    // extra bits of resolution
+static uint8_t           s_input   = 0;    // input currently being converted
+static uint8_t           s_count   = 0;    // conversions accumulated for the current input
+static uint16_t          s_sum     = 0;    // sum of the accumulated conversions
+
+
+namespace rc
+{
+
+// Public functions
+
+void ADCSampler::start(uint8_t p_oversampling, uint8_t p_mask)
+{
+	RC_TRACE("start oversampling: %u mask: %x", p_oversampling, p_mask);
+	RC_ASSERT_MINMAX(p_oversampling, 0, MaxOversampling);
+	RC_ASSERT(p_mask != 0);
+	
+	stop();
+	
+	s_bits  = p_oversampling;
+	s_mask  = p_mask;
+	s_count = 0;
+	s_sum   = 0;
+	
+	// fill both tables so nothing reads garbage before the first round is done
+	for (uint8_t i = 0; i < 8; ++i)
+	{
+		if (s_mask & _BV(i))
+		{
+			uint16_t value = static_cast<uint16_t>(analogRead(i)) << s_bits;
+			s_values[0][i] = value;
+			s_values[1][i] = value;
+		}
+	}
+	
+	// start with the first input
+	s_input = 0;
+	while ((s_mask & _BV(s_input)) == 0)
+	{
+		++s_input;
+	}
+	
+	// ADC is enabled with the /128 prescaler by the Arduino core, we only need the interrupt
+	ADCSRA |= _BV(ADIE);
+	s_running = true;
+	startConversion();
+}
+
+
+void ADCSampler::stop()
+{
+	RC_TRACE("stop");
+	ADCSRA &= ~_BV(ADIE);
+	
+	// wait for a running conversion to finish so analogRead starts clean
+	while (ADCSRA & _BV(ADSC))
+	{
+	}
+	s_running = false;
+}
+
+
+bool ADCSampler::isRunning()
+{
+	return s_running;
+}
+
+
+uint8_t ADCSampler::getOversampling()
+{
+	return s_running ? s_bits : 0;
+}
+
+
+uint16_t ADCSampler::read(uint8_t p_pin)
+{
+	return readOversampled(p_pin) >> getOversampling();
+}
+
+
+uint16_t ADCSampler::readOversampled(uint8_t p_pin)
+{
+	if (s_running == false)
+	{
+		return analogRead(p_pin);
+	}
+	
+	if (p_pin >= A0)
+	{
+		p_pin -= A0;
+	}
+	RC_ASSERT_MINMAX(p_pin, 0, 7);
+	
+	uint8_t oldSREG = SREG;
+	cli();
+	uint16_t value = s_values[s_front][p_pin];
+	SREG = oldSREG;
+	
+	return value;
+}
+
+
+void ADCSampler::isr()
+{
+	s_sum += ADC;
+	++s_count;
+	if (s_count >= (1 << (s_bits << 1)))
+	{
+		// sum of 4^n samples divided by 2^n gives n extra bits
+		s_values[s_front ^ 1][s_input] = s_sum >> s_bits;
+		s_sum   = 0;
+		s_count = 0;
+		
+		// move on to the next input, swap tables once all inputs have been done
+		uint8_t input = s_input;
+		do
+		{
+			input = (input + 1) & 0x07;
+		}
+		while ((s_mask & _BV(input)) == 0);
+		
+		if (input <= s_input)
+		{
+			s_front ^= 1;
+		}
+		s_input = input;
+	}
+	
+	if (s_running)
+	{
+		startConversion();
+	}
+}
+
+
+// Private functions
+
+void ADCSampler::startConversion()
+{
+	// AVcc reference, same as analogRead with DEFAULT reference
+	ADMUX = _BV(REFS0) | s_input;
+	ADCSRA |= _BV(ADSC);
+}
+
+
+// namespace end
+}
+
+
+// Interrupt service routines
+
+ISR(ADC_vect)
+{
+	rc::ADCSampler::isr();
+}
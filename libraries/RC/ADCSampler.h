@@ -0,0 +1,79 @@
+#ifndef INC_RC_ADCSAMPLER_H
+#define INC_RC_ADCSAMPLER_H
+
+/* ---------------------------------------------------------------------------
+** This software is in the public domain, furnished "as is", without technical
+** support, and with no warranty, express or implied, as to its usefulness for
+** any purpose.
+**
+** ADCSampler.h
+** Interrupt driven background sampling of the analog inputs
+**
+** Project: ArduinoRCLib
+** Website: http://sourceforge.net/p/arduinorclib/
+** -------------------------------------------------------------------------*/
+
+#include <inttypes.h>
+
+
+namespace rc
+{
+
+/*! 
+ *  \brief     Class to encapsulate background ADC sampling.
+ *  \details   This class converts the analog inputs A0 - A7 round robin from the ADC interrupt and keeps
+ *             the latest results in a double buffered table, so reading an input never has to wait for
+ *             a conversion. Optionally every input is oversampled and decimated for extra resolution.
+ *  \warning   While the sampler is running analogRead() should <b>NOT</b> be used, use read() instead.
+ *  \copyright Public Domain.
+ */
+class ADCSampler
+{
+public:
+	enum
+	{
+		MaxOversampling = 3 //!< Maximum number of extra bits of resolution
+	};
+	
+	/*! \brief Starts sampling in the background.
+	    \param p_oversampling Extra bits of resolution, range [0 - 3], uses 4^p_oversampling conversions per value.
+	    \param p_mask Bit mask of the analog inputs to sample, bit 0 is A0.*/
+	static void start(uint8_t p_oversampling = 0, uint8_t p_mask = 0xFF);
+	
+	/*! \brief Stops sampling, analogRead() may be used again after this.*/
+	static void stop();
+	
+	/*! \brief Checks if the sampler is running.
+	    \return Whether or not the sampler is running.*/
+	static bool isRunning();
+	
+	/*! \brief Gets the number of extra bits of resolution.
+	    \return Extra bits of resolution, 0 when the sampler isn't running.*/
+	static uint8_t getOversampling();
+	
+	/*! \brief Gets the latest value of an analog input.
+	    \param p_pin The analog pin, A0 - A7 or 0 - 7.
+	    \return The latest value, range [0 - 1023].
+	    \note Falls back to analogRead() if the sampler isn't running.*/
+	static uint16_t read(uint8_t p_pin);
+	
+	/*! \brief Gets the latest value of an analog input at full resolution.
+	    \param p_pin The analog pin, A0 - A7 or 0 - 7.
+	    \return The latest value, range [0 - (1024 << getOversampling()) - 1].
+	    \note Falls back to analogRead() if the sampler isn't running.*/
+	static uint16_t readOversampled(uint8_t p_pin);
+	
+	/*! \brief Handles ADC conversion complete interrupt.*/
+	static void isr();
+	
+private:
+	ADCSampler(); //!< Not instantiable
+	
+	/*! \brief Selects the next input and starts converting it. */
+	static void startConversion();
+};
+
+
+} // namespace end
+
+#endif // INC_RC_ADCSAMPLER_H
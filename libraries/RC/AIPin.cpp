@@ -13,6 +13,7 @@
 
 #include <Arduino.h>
 
+#include <ADCSampler.h>
 #include <AIPin.h>
 #include <rc_debug_lib.h>
 
@@ -143,43 +144,33 @@ void AIPin::setCalibration(uint16_t p_min, uint16_t p_center, uint16_t p_max)
 
 int16_t AIPin::read() const
 {
-	uint16_t raw = analogRead(m_pin);
+	// take the latest conversion from the background sampler, this doesn't block if it's running
+	uint8_t  res = ADCSampler::getOversampling();
+	uint16_t raw = ADCSampler::readOversampled(m_pin);
+	
+	// calibration values are 10 bit, scale them up to the sampler resolution
+	uint16_t center = m_center << res;
+	uint16_t min    = m_min    << res;
+	uint16_t maxraw = m_max    << res;
 	
 	// reverse if needed
-	if (m_reversed) raw = 1023 - raw;
+	if (m_reversed) raw = ((1024 << res) - 1) - raw;
 	
 	// apply trim
-	raw += m_trim;
+	raw += m_trim * (1 << res);
 	
 	// early abort
-	if (raw <= m_min) return writeInputValue(-256);
-	if (raw >= m_max) return writeInputValue( 256);
+	if (raw <= min)    return writeInputValue(-256);
+	if (raw >= maxraw) return writeInputValue( 256);
 	
 	// calculate distance from center and maximum distance from center
-	uint16_t out = raw > m_center ?   raw - m_center : m_center -   raw;
-	uint16_t max = raw > m_center ? m_max - m_center : m_center - m_min;
-	
-	// change the range from [0 - max] to [0 - 256]
-	
-	// first bring the value down to below 256, or we'll be getting overflows, we'll compensate later
-	int bits = 0;
-	while (out >= 256)
-	{
-		out >>= 1;
-		++bits;
-	}
-	
-	out <<= 8;  // multiply by 256
-	out /= max; // bring down to new range
+	uint16_t out = raw > center ?    raw - center : center - raw;
+	uint16_t max = raw > center ? maxraw - center : center - min;
 	
-	// bring the value back up if we did any truncating before
-	while (bits > 0)
-	{
-		out <<= 1;
-		--bits;
-	}
+	// change the range from [0 - max] to [0 - 256], in 32 bits so the oversampled resolution isn't lost
+	out = (static_cast<uint32_t>(out) << 8) / max;
 	
-	return writeInputValue((raw < m_center) ? -out : out);
+	return writeInputValue((raw < center) ? -out : out);
 }
 
 
@@ -13,6 +13,7 @@
 
 #include <Arduino.h>
 
+#include <ADCSampler.h>
 #include <AIPinCalibrator.h>
 #include <rc_debug_lib.h>
 
@@ -113,7 +114,7 @@ void AIPinCalibrator::update()
 
 bool AIPinCalibrator::isDone() const
 {
-	return m_active && m_start != 0 && ((static_cast<uint16_t>(millis()) - m_start) >= Center_Time);
+	return m_active && m_start != 0 && static_cast<uint16_t>(static_cast<uint16_t>(millis()) - m_start) >= Center_Time;
 }
 
 
@@ -131,7 +132,7 @@ void AIPinCalibrator::stop()
 
 uint16_t AIPinCalibrator::read()
 {
-	return analogRead(m_pin->getPin());
+	return ADCSampler::read(m_pin->getPin());
 }
 
 
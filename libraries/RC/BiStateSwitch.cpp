@@ -69,5 +69,12 @@ SwitchState BiStateSwitch::read() const
 }
 
 
+SwitchState BiStateSwitch::read(uint8_t p_port) const
+{
+	bool high = (p_port & digitalPinToBitMask(m_pin)) != 0;
+	return writeSwitchState(high == m_reversed ? SwitchState_Down : SwitchState_Up);
+}
+
+
 // namespace end
 }
@@ -62,6 +62,11 @@ public:
 	    \return Current switch state.*/
 	SwitchState read() const;
 	
+	/*! \brief Processes the pin state sampled by a SwitchBank instead of reading the pin.
+	    \param p_port Debounced state of the port the pin is on, see SwitchBank::getState.
+	    \return Current switch state.*/
+	SwitchState read(uint8_t p_port) const;
+	
 private:
 	uint8_t  m_pin;      //!< Hardware pin.
 	bool     m_reversed; //!< Input reverse.
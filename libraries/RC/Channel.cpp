@@ -130,7 +130,7 @@ uint16_t Channel::apply(int16_t p_value)
 	// we're running the risk of overflows here, so add a bit of precision
 	bool neg = p_value < 0;
 	uint16_t val = static_cast<uint16_t>(neg ? (-p_value) : p_value);
-	val = (val * ep) / 140;
+	val = rc::div140(val * ep);
 	
 	// clamp values
 	if (val > 256) val = 256;
@@ -13,6 +13,7 @@
 
 #include <DualRates.h>
 #include <rc_debug_lib.h>
+#include <util.h>
 
 
 namespace rc
@@ -84,7 +85,7 @@ int16_t DualRates::apply(int16_t p_value) const
 	// so we do this unsigned..
 	uint8_t neg = p_value < 0;
 	uint16_t val = static_cast<uint16_t>(neg ? (-p_value) : p_value);
-	val = (val * m_rate) / 100;
+	val = rc::div100(val * m_rate);
 	return neg ? -static_cast<int16_t>(val) : static_cast<int16_t>(val);
 }
 
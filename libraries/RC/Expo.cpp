@@ -13,6 +13,7 @@
 
 #include <Expo.h>
 #include <rc_debug_lib.h>
+#include <util.h>
 
 
 namespace rc
@@ -131,7 +132,7 @@ int16_t Expo::apply(int16_t p_value) const
 	uint16_t expoval = (lowval + highval) >> 4; // divide by EXPO_POINTS + 1
 	
 	// get weighted average between linear and expo value
-	uint16_t out = ((p_value * (100 - expo)) + (expoval * expo)) / 100;
+	uint16_t out = rc::div100((p_value * (100 - expo)) + (expoval * expo));
 	
 	return neg ? -out : out;
 }
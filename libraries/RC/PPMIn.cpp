@@ -23,6 +23,11 @@
 namespace rc
 {
 
+// Static variables
+
+PPMIn* PPMIn::s_capture = 0;
+
+
 // Public functions
 
 PPMIn::PPMIn()
@@ -35,7 +40,8 @@ m_idx(0),
 m_newFrame(false),
 m_lastFrameTime(0),
 m_lastTime(0),
-m_high(false)
+m_high(false),
+m_capture(false)
 #ifdef RC_USE_PCINT
 ,m_pin(0)
 #endif
@@ -78,8 +84,31 @@ void PPMIn::start(bool p_high)
 }
 
 
+void PPMIn::startCapture(bool p_high)
+{
+	RC_TRACE("start capture, signal high: %d", p_high);
+	m_high = p_high;
+	m_capture = true;
+	s_capture = this;
+	
+	// check if Timer 1 is running or not
+	rc::Timer1::start();
+	
+	// capture the edge after which the pin equals m_high, same edge pinChanged responds to
+	rc::Timer1::setInputCapture(true, p_high, PPMIn::handleCapture);
+}
+
+
 void PPMIn::stop()
 {
+	if (m_capture)
+	{
+		rc::Timer1::setInputCapture(false, false);
+		m_capture = false;
+		s_capture = 0;
+		return;
+	}
+	
 #ifdef RC_USE_PCINT
 	if (m_pin != 0)
 	{
@@ -150,13 +179,76 @@ void PPMIn::pinChanged(bool p_high)
 	uint16_t cnt = TCNT1;
 	SREG = oldSREG;
 	
+	edge(cnt);
+}
+
+
+void PPMIn::captured()
+{
+	// latched by hardware at the edge, we're in the ISR so no need for cli
+	edge(ICR1);
+}
+
+
+bool PPMIn::update()
+{
+	if (m_newFrame)
+	{
+		RC_TRACE("received new frame");
+		m_newFrame = false;
+		m_lastFrameTime = static_cast<uint16_t>(millis());
+		uint16_t* results = getRawInputChannels();
+		for (uint8_t i = 0; i < m_channels && i < RC_MAX_CHANNELS; ++i)
+		{
+			results[i] = m_work[i] >> 1;
+		}
+		return true;
+	}
+	else if (m_state == State_Stable)
+	{
+		uint16_t delta = static_cast<uint16_t>(millis()) - m_lastFrameTime;
+		if (delta >= m_timeout)
+		{
+			// signal lost
+			RC_TRACE("lost signal");
+			m_state = State_Lost;
+		}
+	}
+	return false;
+}
+
+
+// Private functions
+
+#ifdef RC_USE_PCINT
+void PPMIn::isr(uint8_t p_pin, bool p_high, void* p_user)
+{
+	reinterpret_cast<PPMIn*>(p_user)->pinChanged(p_high);
+}
+#endif // RC_USE_PCINT
+
+
+void PPMIn::handleCapture()
+{
+	if (s_capture != 0)
+	{
+		s_capture->captured();
+	}
+}
+
+
+void PPMIn::edge(uint16_t p_time)
+{
+	// Timer 1 wraps, the difference has to wrap with it (on the host int is wider than 16 bits)
+	uint16_t delta = p_time - m_lastTime;
+	
 	switch (m_state)
 	{
 	default:
 	case State_Startup:
 	case State_Lost:
 		{
-			if (cnt - m_lastTime >= m_pauseLength)
+			if (delta >= m_pauseLength)
 			{
 				m_state = State_Listening;
 				m_channels = 0;
@@ -166,7 +258,7 @@ void PPMIn::pinChanged(bool p_high)
 	
 	case State_Listening:
 		{
-			if (cnt - m_lastTime >= m_pauseLength)
+			if (delta >= m_pauseLength)
 			{
 				m_state = State_Stable;
 				m_idx = 0;
@@ -176,7 +268,7 @@ void PPMIn::pinChanged(bool p_high)
 			{
 				if (m_channels < RC_MAX_CHANNELS)
 				{
-					m_work[m_channels] = cnt - m_lastTime;
+					m_work[m_channels] = delta;
 				}
 				++m_channels;
 			}
@@ -185,7 +277,7 @@ void PPMIn::pinChanged(bool p_high)
 	
 	case State_Stable:
 		{
-			if (cnt - m_lastTime >= m_pauseLength)
+			if (delta >= m_pauseLength)
 			{
 				if (m_idx == m_channels)
 				{
@@ -201,54 +293,16 @@ void PPMIn::pinChanged(bool p_high)
 			{
 				if (m_idx < RC_MAX_CHANNELS)
 				{
-					m_work[m_idx] = cnt - m_lastTime;
+					m_work[m_idx] = delta;
 				}
 				++m_idx;
 			}
 		}
 		break;
 	}
-	m_lastTime = cnt;
+	m_lastTime = p_time;
 }
 
 
-bool PPMIn::update()
-{
-	if (m_newFrame)
-	{
-		RC_TRACE("received new frame");
-		m_newFrame = false;
-		m_lastFrameTime = static_cast<uint16_t>(millis());
-		uint16_t* results = getRawInputChannels();
-		for (uint8_t i = 0; i < m_channels && i < RC_MAX_CHANNELS; ++i)
-		{
-			results[i] = m_work[i] >> 1;
-		}
-		return true;
-	}
-	else if (m_state == State_Stable)
-	{
-		uint16_t delta = static_cast<uint16_t>(millis()) - m_lastFrameTime;
-		if (delta >= m_timeout)
-		{
-			// signal lost
-			RC_TRACE("lost signal");
-			m_state = State_Lost;
-		}
-	}
-	return false;
-}
-
-
-// Private functions
-
-#ifdef RC_USE_PCINT
-void PPMIn::isr(uint8_t p_pin, bool p_high, void* p_user)
-{
-	reinterpret_cast<PPMIn*>(p_user)->pinChanged(p_high);
-}
-#endif // RC_USE_PCINT
-
-
 // namespace end
 }
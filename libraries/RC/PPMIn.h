@@ -60,8 +60,18 @@ public:
 	             use rc::ServoOut instead.*/
 	void start(bool p_high = false);
 	
+	/*! \brief Starts measuring using the Timer1 input capture unit.
+	    \param p_high Whether the incoming signal has high or low pulses.
+	    \note The signal must be connected to ICP1 (pin 8 on ATmega328p), setPin is not used.
+	           Edges are timestamped by hardware with the noise canceler enabled, so the
+	           measured channels don't suffer from interrupt latency caused by other interrupts.
+	    \note Only one PPMIn can use the input capture unit at a time.
+	    \warning Do <b>NOT</b> use this together with the standard Arduino Servo library,
+	             use rc::ServoOut instead.*/
+	void startCapture(bool p_high = false);
+	
 	/*! \brief Stops measuring.
-	    \note Will unregister pin change interrupt if you're using that.*/
+	    \note Will unregister pin change interrupt or input capture interrupt if you're using that.*/
 	void stop();
 	
 	/*! \brief Sets minimum pause length, including pulse, in microseconds.
@@ -98,6 +108,10 @@ public:
 	    \note Call this from your interrupt handler if you're handling interrupts yourself.*/
 	void pinChanged(bool p_high);
 	
+	/*! \brief Handles input capture interrupt.
+	    \note Called by the input capture interrupt started by startCapture.*/
+	void captured();
+	
 	/*! \brief Updates the result buffer with new values.
 	    \return Whether anything has been updated.
 	    \note Call this often to detect loss of signal early.*/
@@ -116,6 +130,11 @@ private:
 #ifdef RC_USE_PCINT
 	static void isr(uint8_t p_pin, bool p_high, void* p_user);
 #endif
+	static void handleCapture();
+	
+	void edge(uint16_t p_time);
+	
+	static PPMIn* s_capture; //!< Instance using the input capture unit.
 	
 	State    m_state;       //!< Current state of input signal.
 	uint8_t  m_channels;    //!< Number of channels in input signal.
@@ -130,6 +149,7 @@ private:
 	
 	uint16_t m_lastTime; //!< Time of last interrupt.
 	bool     m_high;     //!< Whether the incoming signal uses high pulses.
+	bool     m_capture;  //!< Whether the input capture unit is used.
 
 #ifdef RC_USE_PCINT
 	uint8_t m_pin;
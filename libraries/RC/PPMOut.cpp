@@ -31,9 +31,21 @@ PPMOut::PPMOut(uint8_t p_channels)
 :
 m_pulseLength(500),
 m_pauseLength(10500),
+m_syncLength(0),
+m_minFrame(0),
 m_channelCount(p_channels),
+m_syncLead(0),
+m_syncPos(0xFF),
+m_frameReady(false),
+m_updateStamp(0),
+m_latency(0),
+m_front(0),
+m_sequence(0),
+m_frameSequence(0),
 m_timingCount((p_channels + 1) * 2)
 {
+	m_frameChannels[0] = p_channels;
+	m_frameChannels[1] = p_channels;
 	s_instance = this;
 }
 
@@ -125,13 +137,85 @@ uint16_t PPMOut::getPauseLength() const
 }
 
 
+void PPMOut::setAdaptiveFrame(uint16_t p_sync, uint16_t p_min)
+{
+	RC_TRACE("set adaptive frame sync %u us min %u us", p_sync, p_min);
+	RC_ASSERT_MINMAX(p_sync, 0, 32766);
+	RC_ASSERT_MINMAX(p_min, 0, 32766);
+	
+	m_syncLength = p_sync << 1;
+	m_minFrame   = p_min << 1;
+}
+
+
+uint16_t PPMOut::getSyncLength() const
+{
+	return m_syncLength >> 1;
+}
+
+
+void PPMOut::setSyncLead(uint16_t p_lead)
+{
+	RC_TRACE("set sync lead %u us", p_lead);
+	RC_ASSERT_MINMAX(p_lead, 0, 32766);
+	
+	m_syncLead = p_lead << 1;
+}
+
+
+uint16_t PPMOut::getSyncLead() const
+{
+	return m_syncLead >> 1;
+}
+
+
+bool PPMOut::isFrameReady()
+{
+	if (m_frameReady)
+	{
+		m_frameReady = false;
+		return true;
+	}
+	return false;
+}
+
+
+uint16_t PPMOut::getLatency() const
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	uint16_t latency = m_latency;
+	SREG = oldSREG;
+	
+	return latency >> 1;
+}
+
+
+uint8_t PPMOut::getFrameSequence() const
+{
+	return m_frameSequence;
+}
+
+
 void PPMOut::update()
 {
+	// fill the buffer the interrupt isn't using, we're the only one switching buffers
+	uint8_t back = m_front ^ 1;
+	
 	const uint16_t* channels = getRawOutputChannels();
 	for (uint8_t i = 0; i < m_channelCount; ++i)
 	{
-		m_channelTimings[i] = channels[i] << 1;
+		m_channelTimings[back][i] = channels[i] << 1;
 	}
+	m_frameChannels[back] = m_channelCount;
+	
+	// hand the complete buffer over, it will be picked up at the next frame boundary
+	uint8_t oldSREG = SREG;
+	cli();
+	m_front = back;
+	++m_sequence;
+	m_updateStamp = TCNT1;
+	SREG = oldSREG;
 }
 
 
@@ -151,20 +235,45 @@ void PPMOut::updateTimings()
     uint16_t* scratch = m_timings;
 
     uint16_t pause = m_pauseLength;
+    
+    // latch the latest complete channel timings
+    const volatile uint16_t* channelTimings = m_channelTimings[m_front];
+    uint8_t channelCount = m_frameChannels[m_front];
+    m_frameSequence = m_sequence;
+
+    uint16_t frame = 0;
 
     // copy all pre-calculated timings
-    for (uint8_t i = 0; i < m_channelCount; ++i)
+    for (uint8_t i = 0; i < channelCount; ++i)
     {
         // set pulse length
         *scratch = m_pulseLength;
         ++scratch;
 
         // set timing
-        *scratch = m_channelTimings[i] - m_pulseLength;
-        pause -= m_channelTimings[i];
+        *scratch = channelTimings[i] - m_pulseLength;
+        frame += channelTimings[i];
         ++scratch;
     }
 
+    if (m_syncLength != 0)
+    {
+        // adaptive frame, as short as the channels and the sync gap allow, but not shorter than the minimum
+        uint16_t length = frame + m_syncLength;
+        if (length < m_minFrame)
+        {
+            length = m_minFrame;
+        }
+        
+        // the frame has to fit the final pulse and a pause even with a sync gap shorter than that
+        if (length < frame + (m_pulseLength << 1))
+        {
+            length = frame + (m_pulseLength << 1);
+        }
+        pause = length;
+    }
+    pause -= frame;
+
     // set final pulse length
     *scratch = m_pulseLength;
     ++scratch;
@@ -173,7 +282,29 @@ void PPMOut::updateTimings()
     *scratch = pause - m_pulseLength;
 
     // update number of timings
-    m_timingCount = (m_channelCount + 1) * 2;
+    m_timingCount = (channelCount + 1) * 2;
+    
+    // the timings get latched when the final pulse ends, find the last edge
+    // that still leaves at least the lead time to calculate new values
+    m_syncPos = 0xFF;
+    if (m_syncLead != 0)
+    {
+        uint16_t remaining = 0;
+        for (int8_t i = m_timingCount - 2; i >= 0; --i)
+        {
+            remaining += m_timings[i];
+            if (remaining >= m_syncLead)
+            {
+                m_syncPos = i;
+                break;
+            }
+        }
+        if (m_syncPos == 0xFF)
+        {
+            // not enough time within the frame, request values right at the latch
+            m_syncPos = m_timingCount - 1;
+        }
+    }
 }
 
 
@@ -188,11 +319,18 @@ void PPMOut::isr()
 		*m_port |= m_mask;
 	}
 	
+	// signal that new values are needed for the next frame
+	if (m_timingPos == m_syncPos)
+	{
+		m_frameReady = true;
+	}
+	
 	// update position
 	++m_timingPos;
 	if (m_timingPos >= m_timingCount)
 	{
 		m_timingPos = 0;
+		m_latency = TCNT1 - m_updateStamp;
 		
 		// we're at the end of frame here, so there's plenty of time to update
 		updateTimings();
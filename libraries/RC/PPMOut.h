@@ -47,7 +47,9 @@ public:
 	void start(uint8_t p_pin, bool p_invert = false);
 	
 	/*! \brief Sets channel count
-	    \param p_channels Channel count.*/
+	    \param p_channels Channel count.
+	    \note Takes effect with the next update(), the count travels with the channel timings
+	          so a frame never mixes the old and the new count.*/
 	void setChannelCount(uint8_t p_channels);
 	
 	/*! \brief Gets channel count.
@@ -70,7 +72,40 @@ public:
 	    \return The current pause length in microseconds.*/
 	uint16_t getPauseLength() const;
 	
-	/*! \brief Updates channel timings, will be sent at next frame.*/
+	/*! \brief Sets up adaptive frame length, each frame is as long as its channels plus a sync gap.
+	    \param p_sync Minimum sync gap between frames in microseconds, 0 to use the fixed pause length.
+	    \param p_min Minimum frame length in microseconds.
+	    \note The sync gap is never shortened, with many channels at full deflection the frame gets longer
+	          than the usual 20-22.5ms instead. Receivers find the frame start by the sync gap alone.*/
+	void setAdaptiveFrame(uint16_t p_sync, uint16_t p_min = 0);
+	
+	/*! \brief Gets the minimum sync gap of the adaptive frame length.
+	    \return The minimum sync gap in microseconds, 0 if the frame length is fixed.*/
+	uint16_t getSyncLength() const;
+	
+	/*! \brief Sets how long before the channel values are latched for the next frame the frame ready flag is raised.
+	    \param p_lead Lead time in microseconds, 0 disables the frame ready flag.
+	    \note The lead time should cover the time needed to calculate and update() the new channel values.*/
+	void setSyncLead(uint16_t p_lead);
+	
+	/*! \brief Gets the lead time of the frame ready flag.
+	    \return The lead time in microseconds.*/
+	uint16_t getSyncLead() const;
+	
+	/*! \brief Checks whether it's time to provide channel values for the next frame, clears the flag.
+	    \return Whether update() should be called now for the values to make it into the next frame.*/
+	bool isFrameReady();
+	
+	/*! \brief Gets the age of the channel values when they were latched for the last frame.
+	    \return Time between the last update() and the start of the last frame in microseconds.*/
+	uint16_t getLatency() const;
+	
+	/*! \brief Gets the sequence number of the channel values sent in the current frame.
+	    \return Sequence number, incremented by every update().*/
+	uint8_t getFrameSequence() const;
+	
+	/*! \brief Updates channel timings, will be sent at next frame.
+	    \note The timings are double buffered, a frame always contains the values of a single update().*/
 	void update();
 	
 	/*! \brief Handles timer interrupt.*/
@@ -85,10 +120,22 @@ private:
 	
 	uint16_t m_pulseLength; //!< Pulse length in timer ticks.
 	uint16_t m_pauseLength; //!< End of frame length in timer ticks.
+	uint16_t m_syncLength;  //!< Minimum sync gap in timer ticks, 0 for fixed frame length.
+	uint16_t m_minFrame;    //!< Minimum adaptive frame length in timer ticks.
 	
 	uint8_t m_channelCount;    //!< Number of active channels.
 	
-	volatile uint16_t m_channelTimings[RC_MAX_CHANNELS + 1]; //!< Timings per channel, in timer ticks.
+	uint16_t          m_syncLead;    //!< Frame ready lead time in timer ticks.
+	uint8_t           m_syncPos;     //!< Position in timings buffer at which the frame ready flag is raised.
+	volatile bool     m_frameReady;  //!< Frame ready flag.
+	uint16_t          m_updateStamp; //!< Timer value at last update.
+	volatile uint16_t m_latency;     //!< Age of the channel timings at the last frame latch, in timer ticks.
+	
+	volatile uint16_t m_channelTimings[2][RC_MAX_CHANNELS + 1]; //!< Double buffered timings per channel, in timer ticks.
+	volatile uint8_t  m_frameChannels[2]; //!< Number of channels in each buffer.
+	volatile uint8_t  m_front;         //!< Buffer holding the latest complete channel timings.
+	volatile uint8_t  m_sequence;      //!< Sequence number of the latest complete channel timings.
+	volatile uint8_t  m_frameSequence; //!< Sequence number of the channel timings in the current frame.
 	
 	uint8_t   m_timingCount;                        //!< Number of active timings.
 	uint8_t   m_timingPos;                          //!< Current position in timings buffer.
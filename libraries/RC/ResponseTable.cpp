@@ -0,0 +1,93 @@
+/* ---------------------------------------------------------------------------
+** This software is in the public domain, furnished "as is", without technical
+** support, and with no warranty, express or implied, as to its usefulness for
+** any purpose.
+**
+** ResponseTable.cpp
+** Pre-calculated stick response (expo and dual rates) functionality
+**
+** Project: ArduinoRCLib
+** Website: http://sourceforge.net/p/arduinorclib/
+** -------------------------------------------------------------------------*/
+
+#include <DualRates.h>
+#include <Expo.h>
+#include <ResponseTable.h>
+#include <rc_debug_lib.h>
+
+
+namespace rc
+{
+
+// Public functions
+
+ResponseTable::ResponseTable(Input p_index)
+:
+InputModifier(p_index),
+m_carry(PointCount - 1)
+{
+	for (uint8_t i = 0; i < PointCount; ++i)
+	{
+		m_points[i] = static_cast<uint8_t>(i << 4);
+	}
+}
+
+
+void ResponseTable::compile(const Expo& p_expo, const DualRates& p_rates)
+{
+	RC_TRACE("compile expo: %d rate: %u", p_expo.get(), p_rates.get());
+	
+	m_carry = PointCount;
+	for (uint8_t i = 0; i < PointCount; ++i)
+	{
+		uint16_t value = static_cast<uint16_t>(p_rates.apply(p_expo.apply(i << 4)));
+		m_points[i] = static_cast<uint8_t>(value & 0xFF);
+		if (value > 0xFF && m_carry == PointCount)
+		{
+			m_carry = i;
+		}
+	}
+}
+
+
+int16_t ResponseTable::apply(int16_t p_value) const
+{
+	RC_ASSERT_MINMAX(p_value, -256, 256);
+	
+	// save sign
+	bool neg = p_value < 0;
+	uint16_t value = static_cast<uint16_t>(neg ? -p_value : p_value);
+	
+	uint8_t index = value >> 4;   // divide by 16, the distance between points
+	uint8_t rem   = value & 0x0F; // remainder of the divide by 16
+	
+	uint16_t out = getPoint(index);
+	if (rem != 0)
+	{
+		// linear interpolation towards the next point, the response never decreases
+		out += ((getPoint(index + 1) - out) * rem) >> 4;
+	}
+	
+	return neg ? -static_cast<int16_t>(out) : static_cast<int16_t>(out);
+}
+
+
+void ResponseTable::apply() const
+{
+	if (m_index != Input_None)
+	{
+		rc::setInput(m_index, apply(rc::getInput(m_index)));
+	}
+}
+
+
+// Private functions
+
+uint16_t ResponseTable::getPoint(uint8_t p_point) const
+{
+	return (p_point >= m_carry) ? m_points[p_point] + 256 : m_points[p_point];
+}
+
+
+// namespace end
+}
@@ -0,0 +1,73 @@
+#ifndef INC_RC_RESPONSETABLE_H
+#define INC_RC_RESPONSETABLE_H
+
+/* ---------------------------------------------------------------------------
+** This software is in the public domain, furnished "as is", without technical
+** support, and with no warranty, express or implied, as to its usefulness for
+** any purpose.
+**
+** ResponseTable.h
+** Pre-calculated stick response (expo and dual rates) functionality
+**
+** Project: ArduinoRCLib
+** Website: http://sourceforge.net/p/arduinorclib/
+** -------------------------------------------------------------------------*/
+
+#include <inttypes.h>
+
+#include <InputModifier.h>
+
+
+namespace rc
+{
+
+class DualRates;
+class Expo;
+
+/*! 
+ *  \brief     Class to encapsulate a pre-calculated stick response.
+ *  \details   This class compiles expo and dual rates into a single piecewise linear table,
+ *             applying it takes one table lookup and one multiply instead of two interpolations
+ *             and divisions. The response is symmetric, so only the positive half is stored.
+ *  \copyright Public Domain.
+ */
+class ResponseTable : public InputModifier
+{
+public:
+	/*! \brief Nameless enum, magic number hiding. */
+	enum
+	{
+		PointCount = 17 //!< Amount of points in the table, covering [0 - 256] in steps of 16
+	};
+	
+	/*! \brief Constructs a linear ResponseTable object
+	    \param p_index Input index to use for input and output.*/
+	ResponseTable(Input p_index = Input_None);
+	
+	/*! \brief Compiles expo followed by dual rates into the table.
+	    \param p_expo The expo to apply first.
+	    \param p_rates The dual rates to apply after expo.*/
+	void compile(const Expo& p_expo, const DualRates& p_rates);
+	
+	/*! \brief Applies the response.
+	    \param p_value Source value, range [-256 - 256].
+	    \return Response applied to p_value, range 140% [-358 - 358].*/
+	int16_t apply(int16_t p_value) const;
+	
+	/*! \brief Applies the response to the set input.*/
+	void apply() const;
+	
+private:
+	/*! \brief Gets a table point.
+	    \param p_point The point to get, range [0 - PointCount-1].
+	    \return The value of the point, range [0 - 358].*/
+	uint16_t getPoint(uint8_t p_point) const;
+	
+	uint8_t m_points[PointCount]; //!< Lower 8 bits of the response at each point.
+	uint8_t m_carry;              //!< First point of which the value is 256 or more, the response never decreases.
+};
+
+
+} // namespace end
+
+#endif // INC_RC_RESPONSETABLE_H
@@ -31,6 +31,10 @@ ServoOut::ServoOut(const uint8_t* p_pins)
 :
 m_pauseLength(10000),
 m_pins(p_pins),
+m_front(0),
+m_current(0),
+m_sequence(0),
+m_frameSequence(0),
 m_activePort(0),
 m_activeMask(0),
 m_nextPort(0),
@@ -44,8 +48,9 @@ m_idx(0)
 void ServoOut::start()
 {
 	RC_TRACE("start");
-	// set initial values
+	// set initial values, and use them right from the first frame
 	update(true);
+	m_current = m_front;
 	
 	// stop timer 1
 	rc::Timer1::stop();
@@ -81,35 +86,51 @@ uint16_t ServoOut::getPauseLength() const
 
 void ServoOut::update(bool p_pinsChanged)
 {
+	// pick the buffer the interrupt isn't using, and withdraw any buffer that hasn't been picked up yet.
+	// Only this needs interrupts disabled, the buffer itself is filled without blocking the interrupt.
+	uint8_t oldSREG = SREG;
+	cli();
+	uint8_t latest = m_front;
+	m_front = m_current;
+	uint8_t back = m_current ^ 1;
+	SREG = oldSREG;
+	
 	uint16_t remainingTime = m_pauseLength;
 	uint8_t idx = 0;
 	
+	volatile uint16_t* timings = m_timings[back];
+	volatile uint8_t*  ports   = m_ports[back];
+	volatile uint8_t*  masks   = m_masks[back];
+	
 	const uint16_t* values = getRawOutputChannels();
 	for (uint8_t i = 0; i < RC_MAX_CHANNELS; ++i)
 	{
 		if (m_pins[i] != 0 && values[i] != 0)
 		{
+			RC_ASSERT_MINMAX(values[i], 0, 32766);
+			
+			timings[idx] = values[i] << 1;
+			
 			if (p_pinsChanged)
 			{
 				uint8_t mask = digitalPinToBitMask(m_pins[i]);
 				uint8_t port = digitalPinToPort(m_pins[i]);
 				volatile uint8_t* out = portInputRegister(port);
 				
-				RC_ASSERT_MINMAX(values[i], 0, 32766);
-				
-				TIMSK1 &= ~(1 << OCIE1B);
-				m_timings[idx] = values[i] << 1;
-				m_ports[idx] = static_cast<uint8_t>(reinterpret_cast<uint16_t>(out) & 0xFF);
-				m_masks[idx] = mask;
-				TIMSK1 |= (1 << OCIE1B);
+#ifdef __AVR__
+				ports[idx] = static_cast<uint8_t>(reinterpret_cast<uint16_t>(out) & 0xFF);
+#else
+				// host pointers don't fit in a byte, keep the port number instead
+				(void)out;
+				ports[idx] = port;
+#endif
+				masks[idx] = mask;
 			}
-			else
+			else if (latest != back)
 			{
-				RC_ASSERT_MINMAX(values[i], 0, 32766);
-				
-				TIMSK1 &= ~(1 << OCIE1B);
-				m_timings[idx] = values[i] << 1;
-				TIMSK1 |= (1 << OCIE1B);
+				// pins haven't changed, take ports and masks from the latest buffer
+				ports[idx] = m_ports[latest][idx];
+				masks[idx] = m_masks[latest][idx];
 			}
 			
 			if (remainingTime < values[i])
@@ -125,11 +146,25 @@ void ServoOut::update(bool p_pinsChanged)
 		}
 	}
 	
-	TIMSK1 &= ~(1 << OCIE1B);
-	m_timings[idx] = remainingTime << 1;
-	m_ports[idx] = 0;
-	m_masks[idx] = 0;
-	TIMSK1 = (1 << OCIE1B);
+	timings[idx] = remainingTime << 1;
+	ports[idx] = 0;
+	masks[idx] = 0;
+	
+	// terminate the frame
+	timings[idx + 1] = 0;
+	
+	// hand the complete buffer over, it will be picked up at the next frame boundary
+	oldSREG = SREG;
+	cli();
+	m_front = back;
+	++m_sequence;
+	SREG = oldSREG;
+}
+
+
+uint8_t ServoOut::getFrameSequence() const
+{
+	return m_frameSequence;
 }
 
 
@@ -163,7 +198,7 @@ void ServoOut::isr()
 	}
 	
 	// update compare register
-	OCR1B += m_timings[m_idx];
+	OCR1B += m_timings[m_current][m_idx];
 	
 	// update active
 	m_activePort = m_nextPort;
@@ -171,14 +206,22 @@ void ServoOut::isr()
 	
 	// update index
 	++m_idx;
-	if (m_idx > RC_MAX_CHANNELS || m_timings[m_idx] == 0)
+	if (m_idx > RC_MAX_CHANNELS || m_timings[m_current][m_idx] == 0)
 	{
 		m_idx = 0;
+		
+		// frame boundary, switch to the latest complete buffer
+		m_current = m_front;
+		m_frameSequence = m_sequence;
 	}
 	
 	// get next port and mask
-	m_nextPort = reinterpret_cast<volatile uint8_t*>(m_ports[m_idx]);
-	m_nextMask = m_masks[m_idx];
+#ifdef __AVR__
+	m_nextPort = reinterpret_cast<volatile uint8_t*>(m_ports[m_current][m_idx]);
+#else
+	m_nextPort = m_ports[m_current][m_idx] != 0 ? portInputRegister(m_ports[m_current][m_idx]) : 0;
+#endif
+	m_nextMask = m_masks[m_current][m_idx];
 }
 
 
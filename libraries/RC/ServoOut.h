@@ -50,9 +50,14 @@ public:
 	uint16_t getPauseLength() const;
 	
 	/*! \brief Updates all internal timings.
-	    \param p_pinsChanged If any pins have changed, set this to true.*/
+	    \param p_pinsChanged If any pins have changed, set this to true.
+	    \note The timings are double buffered, a frame always contains the values of a single update().*/
 	void update(bool p_pinsChanged = false);
 	
+	/*! \brief Gets the sequence number of the timings sent in the current frame.
+	    \return Sequence number, incremented by every update().*/
+	uint8_t getFrameSequence() const;
+	
 	/*! \brief Handles timer interrupt.*/
 	static void handleInterrupt();
 	
@@ -64,9 +69,14 @@ private:
 	
 	const uint8_t* m_pins;   //!< External buffer defining pins to use.
 	
-	volatile uint16_t m_timings[RC_MAX_CHANNELS]; //!< Work buffer containing timings.
-	volatile uint8_t  m_ports[RC_MAX_CHANNELS];   //!< Work buffer containing port addresses.
-	volatile uint8_t  m_masks[RC_MAX_CHANNELS];   //!< Work buffer containing bitmasks.
+	volatile uint16_t m_timings[2][RC_MAX_CHANNELS + 2]; //!< Double buffered work buffer containing timings, pause and terminator.
+	volatile uint8_t  m_ports[2][RC_MAX_CHANNELS + 2];   //!< Double buffered work buffer containing port addresses.
+	volatile uint8_t  m_masks[2][RC_MAX_CHANNELS + 2];   //!< Double buffered work buffer containing bitmasks.
+	
+	volatile uint8_t m_front;         //!< Buffer holding the latest complete timings.
+	volatile uint8_t m_current;       //!< Buffer used by the interrupt for the current frame.
+	volatile uint8_t m_sequence;      //!< Sequence number of the latest complete timings.
+	volatile uint8_t m_frameSequence; //!< Sequence number of the timings in the current frame.
 	
 	volatile uint8_t* m_activePort; //!< Address of port of currently active (high) pin.
 	         uint8_t  m_activeMask; //!< Inverted bitmask of currently active (high) pin.
@@ -0,0 +1,64 @@
+/* ---------------------------------------------------------------------------
+** This software is in the public domain, furnished "as is", without technical
+** support, and with no warranty, express or implied, as to its usefulness for
+** any purpose.
+**
+** SwitchBank.cpp
+** Debounced sampling of all switches on one port at once
+**
+** Project: ArduinoRCLib
+** Website: http://sourceforge.net/p/arduinorclib/
+** -------------------------------------------------------------------------*/
+
+#include <Arduino.h>
+
+#include <SwitchBank.h>
+#include <rc_debug_lib.h>
+
+
+namespace rc
+{
+
+// Public functions
+
+SwitchBank::SwitchBank(volatile uint8_t* p_port, uint8_t p_mask)
+:
+m_port(p_port),
+m_mask(p_mask),
+m_state(0),
+m_count0(0xFF),
+m_count1(0xFF)
+{
+	reset();
+}
+
+
+void SwitchBank::reset()
+{
+	m_state  = *m_port & m_mask;
+	m_count0 = 0xFF;
+	m_count1 = 0xFF;
+}
+
+
+uint8_t SwitchBank::update()
+{
+	// pins that differ from their debounced state count down from 3, all others are held at 3.
+	// a pin that reaches 0 toggles its debounced state, which stops its count.
+	uint8_t delta = (*m_port & m_mask) ^ m_state;
+	m_count0 = ~(m_count0 & delta);
+	m_count1 = m_count0 ^ (m_count1 & delta);
+	delta &= m_count0 & m_count1;
+	m_state ^= delta;
+	return delta;
+}
+
+
+uint8_t SwitchBank::getState() const
+{
+	return m_state;
+}
+
+
+// namespace end
+}
@@ -0,0 +1,61 @@
+#ifndef INC_RC_SWITCHBANK_H
+#define INC_RC_SWITCHBANK_H
+
+/* ---------------------------------------------------------------------------
+** This software is in the public domain, furnished "as is", without technical
+** support, and with no warranty, express or implied, as to its usefulness for
+** any purpose.
+**
+** SwitchBank.h
+** Debounced sampling of all switches on one port at once
+**
+** Project: ArduinoRCLib
+** Website: http://sourceforge.net/p/arduinorclib/
+** -------------------------------------------------------------------------*/
+
+#include <inttypes.h>
+
+
+namespace rc
+{
+
+/*! 
+ *  \brief     Class to sample and debounce all switch pins of a port together.
+ *  \details   Reads the input register of a port once per update and debounces all of its pins in
+ *             parallel with two bit vertical counters: a pin has to read the same for 4 updates in a row
+ *             before its debounced state follows. BiStateSwitch::read(uint8_t) and TriStateSwitch::read(uint8_t)
+ *             turn the debounced state into switch states, so they only need to run when a pin changed.
+ *  \warning   All switch pins handed to one bank have to be on the same port.
+ *  \copyright Public Domain.
+ */
+class SwitchBank
+{
+public:
+	/*! \brief Constructs a SwitchBank object
+	    \param p_port Input register of the port, e.g. &PIND.
+	    \param p_mask Bit mask of the pins to debounce, other pins always read low.*/
+	SwitchBank(volatile uint8_t* p_port, uint8_t p_mask = 0xFF);
+	
+	/*! \brief Takes over the current pin states without debouncing, e.g. after the pins were set up.*/
+	void reset();
+	
+	/*! \brief Reads the port once and advances the debounce counters.
+	    \return Bit mask of the pins whose debounced state changed, 0 if nothing changed.*/
+	uint8_t update();
+	
+	/*! \brief Gets the debounced pin states.
+	    \return Debounced state of the port, masked.*/
+	uint8_t getState() const;
+	
+private:
+	volatile uint8_t* m_port;  //!< Input register of the port.
+	uint8_t           m_mask;  //!< Pins to debounce.
+	uint8_t           m_state; //!< Debounced pin states.
+	uint8_t           m_count0; //!< Bit 0 of the vertical counter of each pin.
+	uint8_t           m_count1; //!< Bit 1 of the vertical counter of each pin.
+};
+
+
+} // namespace end
+
+#endif // INC_RC_SWITCHBANK_H
@@ -21,6 +21,7 @@
 static rc::Timer1::Callback s_TOIE1Callback = 0;
 static rc::Timer1::Callback s_OCI1ACallback = 0;
 static rc::Timer1::Callback s_OCI1BCallback = 0;
+static rc::Timer1::Callback s_ICP1Callback  = 0;
 bool s_debug = false;
 
 namespace rc
@@ -46,7 +47,7 @@ void Timer1::start()
 {
 	RC_TRACE("start");
 	TCCR1B = (TCCR1B & ~(_BV(CS12) | _BV(CS11) | _BV(CS10))) |
-	         s_debug ? (_BV(CS12) | _BV(CS10)) :  _BV(CS11);
+	         (s_debug ? (_BV(CS12) | _BV(CS10)) :  _BV(CS11));
 }
 
 
@@ -111,6 +112,25 @@ void Timer1::setOverflow(bool p_enable, Callback p_callback)
 }
 
 
+void Timer1::setInputCapture(bool p_enable, bool p_rising, Callback p_callback)
+{
+	RC_TRACE("set input capture enable: %d rising: %d Callback: %p", p_enable, p_rising, p_callback);
+	if (p_enable)
+	{
+		s_ICP1Callback = p_callback;
+		TCCR1B = (TCCR1B & ~_BV(ICES1)) | _BV(ICNC1) | (p_rising ? _BV(ICES1) : 0);
+		TIFR1  = _BV(ICF1); // discard any edge captured before now
+		TIMSK1 |= _BV(ICIE1);
+	}
+	else
+	{
+		TIMSK1 &= ~_BV(ICIE1);
+		TCCR1B &= ~(_BV(ICNC1) | _BV(ICES1));
+		s_ICP1Callback = 0;
+	}
+}
+
+
 void Timer1::setToggle(bool p_enable, bool p_OC1A)
 {
 	RC_TRACE("set toggle enable: %d OC1A: %d", p_enable, p_OC1A);
@@ -155,3 +175,12 @@ ISR(TIMER1_COMPB_vect)
 		s_OCI1BCallback();
 	}
 }
+
+
+ISR(TIMER1_CAPT_vect)
+{
+	if (s_ICP1Callback != 0)
+	{
+		s_ICP1Callback();
+	}
+}
@@ -60,6 +60,13 @@ public:
 	    \param p_callback Function to call at interrupt.*/
 	static void setOverflow(bool p_enable, Callback p_callback = 0);
 	
+	/*! \brief Enables/Disables Input Capture Interrupt on ICP1 (pin 8 on ATmega328p).
+	    \param p_enable Whether to enable or disable Input Capture Interrupt.
+	    \param p_rising Whether to capture on the rising or the falling edge.
+	    \param p_callback Function to call at interrupt, read the captured time from ICR1.
+	    \note The noise canceler is enabled, it delays the capture by a constant four clock cycles.*/
+	static void setInputCapture(bool p_enable, bool p_rising, Callback p_callback = 0);
+	
 	/*! \brief Enables/Disables Toggle pin on Compare Match A.
 	    \param p_enable Whether to enable or disable toggle pin.
 	    \param p_OC1A Whether to toggle OC1A or OC1B.*/
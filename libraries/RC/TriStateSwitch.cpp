@@ -91,5 +91,16 @@ SwitchState TriStateSwitch::read() const
 }
 
 
+SwitchState TriStateSwitch::read(uint8_t p_port) const
+{
+	bool up   = (p_port & digitalPinToBitMask(m_upPin))   != 0;
+	bool down = (p_port & digitalPinToBitMask(m_downPin)) != 0;
+	
+	// same as read()
+	return writeSwitchState(up == down ? SwitchState_Center :
+	                        (up == m_reversed ? SwitchState_Down : SwitchState_Up));
+}
+
+
 // namespace end
 }
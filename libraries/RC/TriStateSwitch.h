@@ -71,6 +71,11 @@ public:
 	    \return Current switch state.*/
 	SwitchState read() const;
 	
+	/*! \brief Processes pin states sampled by a SwitchBank instead of reading the pins.
+	    \param p_port Debounced state of the port the pins are on, see SwitchBank::getState.
+	    \return Current switch state.*/
+	SwitchState read(uint8_t p_port) const;
+	
 private:
 	uint8_t  m_upPin;    //!< Hardware pin for up position.
 	uint8_t  m_downPin;  //!< Hardware pin for down position.
@@ -35,6 +35,10 @@ void setup()
 	
 	// start listening
 	g_PPMIn.start();
+	
+	// alternatively, since pin 8 is ICP1, let the Timer1 input capture unit
+	// timestamp the edges; this is more accurate when other interrupts are busy.
+	// g_PPMIn.startCapture();
 }
 
 
@@ -57,6 +57,8 @@ namespace rc
 		Output_AUX2, //!< added by kone
 		Output_AUX3, //!< added by kone
 		Output_AUX4, //!< added by kone
+		Output_VFM,  //!< added by kone, virtual flight mode switch
+		Output_NUL,  //!< added by kone, never written, feeds empty channels with 0
 		
 		Output_Count,
 		Output_None //!< No output, special case
@@ -21,6 +21,11 @@ namespace rc
 static uint16_t s_center = 1520;
 static uint16_t s_travel = 600;
 
+// reciprocal of (s_travel >> 2) for microsToNormalized, so we multiply and shift instead of divide
+// the defaults belong to a travel of 600, setTravel recalculates them
+static uint16_t s_travelRecip = 55925;
+static uint8_t  s_travelShift = 23;
+
 int16_t microsToNormalized(uint16_t p_micros)
 {
 	// first we clip values, early abort.
@@ -39,12 +44,14 @@ int16_t microsToNormalized(uint16_t p_micros)
 	// we need to multiply by end range 256 and divide by start range m_travel
 	// and we need to do this without risking overflows...
 	
-	// The max value in delta will be s_travel, about 1000. This gives us 6 bits of room to play with
+	// The max value in delta will be s_travel, below 1024. This gives us 6 bits of room to play with
 	// So instead of multiplying with 256 and dividing by s_travel,
 	// we multiply by 64 and divide by s_travel / 4
 	// we lose the last two bits of the division, but that's not going to make much of a difference...
+	// The division is done by multiplying with the reciprocal calculated in setTravel,
+	// this gives the exact same result for travels up to 851 and is at most 1 higher above that.
 	delta <<= 6;
-	delta /= (s_travel >> 2);
+	delta = static_cast<uint16_t>((static_cast<uint32_t>(delta) * s_travelRecip) >> s_travelShift);
 	
 	return (p_micros >= s_center) ? delta : -delta;
 }
@@ -168,11 +175,28 @@ int16_t mix(int16_t p_value, int8_t p_mix)
 	bool valneg = p_value < 0;
 	uint16_t value =  static_cast<uint16_t>(valneg ? -p_value : p_value);
 	valneg ^= p_mix < 0;
-	value = (value * static_cast<uint16_t>(p_mix > 0 ? p_mix : -p_mix)) / 100;
+	value = div100(value * static_cast<uint16_t>(p_mix > 0 ? p_mix : -p_mix));
 	return valneg ? -static_cast<int16_t>(value) : static_cast<int16_t>(value);
 }
 
 
+uint16_t div100(uint16_t p_value)
+{
+	RC_ASSERT_MINMAX(p_value, 0, 43698);
+	
+	// 5243 / 2^19 is slightly more than 1 / 100, the error stays below the
+	// remainder for all values up to 43698 so the result is exact
+	return static_cast<uint16_t>((static_cast<uint32_t>(p_value) * 5243) >> 19);
+}
+
+
+uint16_t div140(uint16_t p_value)
+{
+	// 59919 / 2^23 is slightly more than 1 / 140, exact for all 16 bit values
+	return static_cast<uint16_t>((static_cast<uint32_t>(p_value) * 59919) >> 23);
+}
+
+
 void setCenter(uint16_t p_center)
 {
 	RC_TRACE("set center: %u ms", p_center);
@@ -192,10 +216,25 @@ uint16_t getCenter()
 void setTravel(uint16_t p_travel)
 {
 	RC_TRACE("set travel: %u ms", p_travel);
-	RC_ASSERT_MINMAX(p_travel, 0, 32766);
+	RC_ASSERT_MINMAX(p_travel, 0, 1023); // microsToNormalized shifts the delta left by 6
 	RC_ASSERT(p_travel <= getCenter());
 	
 	s_travel = p_travel;
+	
+	// pre-calculate the reciprocal of the divisor used in microsToNormalized
+	// use the largest shift for which the reciprocal still fits in 16 bits
+	uint16_t divisor = s_travel >> 2;
+	if (divisor == 0)
+	{
+		divisor = 1;
+	}
+	uint8_t shift = 0;
+	while (shift < 31 && (((1UL << (shift + 1)) + divisor - 1) / divisor) <= 0xFFFF)
+	{
+		++shift;
+	}
+	s_travelRecip = static_cast<uint16_t>(((1UL << shift) + divisor - 1) / divisor);
+	s_travelShift = shift;
 }
 
 
@@ -28,7 +28,9 @@ namespace rc
 {
 	/*! \brief convert microseconds to a normalized value [-256 - 256].
 	    \param p_micros Input in microseconds.
-	    \return Normalized value, range [-256 - 256].*/
+	    \return Normalized value, range [-256 - 256].
+	    \note Same as (delta * 64) / (travel / 4) for travels up to 851 microseconds,
+	          up to 1 higher for travels of 852 to 1023, see setTravel.*/
 	int16_t microsToNormalized(uint16_t p_micros);
 	
 	/*! \brief convert a normalized value [-256 - 256] to microseconds.
@@ -64,6 +66,16 @@ namespace rc
 	    \return Mix applied to value.*/
 	int16_t mix(int16_t p_value, int8_t p_mix);
 	
+	/*! \brief Divide by 100 using a multiplication with a pre-calculated reciprocal.
+	    \param p_value Value to divide, range [0 - 43698].
+	    \return p_value / 100, rounded down, same as integer division within the range.*/
+	uint16_t div100(uint16_t p_value);
+	
+	/*! \brief Divide by 140 using a multiplication with a pre-calculated reciprocal.
+	    \param p_value Value to divide, range [0 - 65535].
+	    \return p_value / 140, rounded down, same as integer division.*/
+	uint16_t div140(uint16_t p_value);
+	
 	/*! \brief Sets servo center.
 	    \param p_center Center of servo in microseconds.*/
 	void setCenter(uint16_t p_center);
@@ -73,7 +85,9 @@ namespace rc
 	uint16_t getCenter();
 	
 	/*! \brief Sets maximum travel from center.
-	    \param p_travel Travel of servo in microseconds.*/
+	    \param p_travel Travel of servo in microseconds, range [0 - 1023].
+	    \note This pre-calculates the reciprocal used by microsToNormalized. The reciprocal is exact
+	          for travels up to 851, above that microsToNormalized may round up by 1.*/
 	void setTravel(uint16_t p_travel);
 	
 	/*! \brief Gets maximum travel from center.